@@ -0,0 +1,49 @@
+/**
+ * AdaptivePoller.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "AdaptivePoller.h"
+
+void AdaptivePoller::configure(uint32_t min_interval_ms, uint32_t max_interval_ms) {
+    min_interval_ = min_interval_ms;
+    max_interval_ = max_interval_ms < min_interval_ms ? min_interval_ms : max_interval_ms;
+    interval_ = min_interval_;
+}
+
+bool AdaptivePoller::tick(uint32_t now_ms) {
+    if (enabled_ && !sync_due_ && now_ms - last_sync_at_ < interval_) {
+        skipped_++;
+        return false;
+    }
+
+    sync_due_ = false;
+    last_sync_at_ = now_ms;
+    syncs_++;
+    window_syncs_++;
+
+    if (enabled_ && interval_ < max_interval_ && ++quiet_syncs_ >= STABLE_SYNCS) {
+        quiet_syncs_ = 0;
+        interval_ = interval_ * 2 > max_interval_ ? max_interval_ : interval_ * 2;
+    }
+    return true;
+}
+
+void AdaptivePoller::onActivity() {
+    interval_ = min_interval_;
+    quiet_syncs_ = 0;
+    sync_due_ = true;
+}
+
+uint32_t AdaptivePoller::takeEffectiveInterval(uint32_t now_ms) {
+    uint32_t elapsed = now_ms - window_start_;
+    uint32_t syncs = window_syncs_;
+    window_start_ = now_ms;
+    window_syncs_ = 0;
+    if (syncs == 0) {
+        return elapsed;
+    }
+    return elapsed / syncs;
+}
@@ -0,0 +1,62 @@
+/**
+ * AdaptivePoller.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef ADAPTIVEPOLLER_H
+#define ADAPTIVEPOLLER_H
+
+#include <stdint.h>
+
+// Decides which update() ticks sync with the heatpump.
+//
+// Right after a command or a settings change every tick syncs. While the
+// unit stays idle and stable the interval between syncs doubles, up to
+// max_interval, and drops back to every tick on the next activity. When
+// disabled every tick syncs, but the effective poll rate is still measured.
+class AdaptivePoller {
+public:
+    // Number of quiet syncs at the current interval before backing off. The
+    // HeatPump library requests one kind of info packet per sync, so this
+    // lets it cycle through settings, room temperature and status first.
+    static const uint8_t STABLE_SYNCS = 4;
+
+    void configure(uint32_t min_interval_ms, uint32_t max_interval_ms);
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+    bool isEnabled() const { return enabled_; }
+
+    // Called on every update() tick. Returns true if the heatpump should be
+    // synced on this tick.
+    bool tick(uint32_t now_ms);
+
+    // Called after a control() call or a settings change reported by the
+    // unit, so feedback is picked up at the fastest rate.
+    void onActivity();
+
+    // Current interval between syncs.
+    uint32_t getInterval() const { return interval_; }
+
+    // Average time between syncs since the previous call, in milliseconds.
+    uint32_t takeEffectiveInterval(uint32_t now_ms);
+
+    uint32_t getSyncs() const { return syncs_; }
+    uint32_t getSkipped() const { return skipped_; }
+
+private:
+    bool enabled_ = false;
+    uint32_t min_interval_ = 0;
+    uint32_t max_interval_ = 0;
+    uint32_t interval_ = 0;
+    uint32_t last_sync_at_ = 0;
+    bool sync_due_ = true;
+    uint8_t quiet_syncs_ = 0;
+
+    uint32_t syncs_ = 0;
+    uint32_t skipped_ = 0;
+    uint32_t window_start_ = 0;
+    uint32_t window_syncs_ = 0;
+};
+
+#endif
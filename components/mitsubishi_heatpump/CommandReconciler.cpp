@@ -0,0 +1,159 @@
+/**
+ * CommandReconciler.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "CommandReconciler.h"
+#include "esphome.h"
+
+using esphome::esp_log_printf_;
+
+// Indexed by the bit position of each PendingWrite field.
+static const char* const FIELD_NAMES[PendingWrite::FIELD_COUNT] = {
+    "power", "mode", "temperature", "fan", "vane", "wide vane"
+};
+
+// Copies field from source to destination.
+static void copyField(uint8_t field, const PendingWrite& source, PendingWrite* destination) {
+    switch (field) {
+        case PendingWrite::POWER:
+            destination->power = source.power;
+            break;
+        case PendingWrite::MODE:
+            destination->mode = source.mode;
+            break;
+        case PendingWrite::TEMPERATURE:
+            destination->temperature = source.temperature;
+            break;
+        case PendingWrite::FAN:
+            destination->fan = source.fan;
+            break;
+        case PendingWrite::VANE:
+            destination->vane = source.vane;
+            break;
+        case PendingWrite::WIDE_VANE:
+            destination->wideVane = source.wideVane;
+            break;
+    }
+}
+
+template<typename A, typename B>
+bool CommandReconciler::fieldEquals(uint8_t field, const A& a, const B& b) {
+    switch (field) {
+        case PendingWrite::POWER:
+            return a.power == b.power;
+        case PendingWrite::MODE:
+            return a.mode == b.mode;
+        case PendingWrite::TEMPERATURE:
+            return a.temperature == b.temperature;
+        case PendingWrite::FAN:
+            return a.fan == b.fan;
+        case PendingWrite::VANE:
+            return a.vane == b.vane;
+        case PendingWrite::WIDE_VANE:
+            return a.wideVane == b.wideVane;
+        default:
+            return true;
+    }
+}
+
+void CommandReconciler::onWritten(const PendingWrite& write, uint32_t now_ms) {
+    for (uint8_t i = 0; i < PendingWrite::FIELD_COUNT; i++) {
+        uint8_t field = 1 << i;
+        if (!(write.dirty & field)) {
+            continue;
+        }
+
+        bool retry = (retrying_ & field) && (in_flight_.dirty & field) &&
+            fieldEquals(field, write, in_flight_);
+        retrying_ &= ~field;
+        if (retry) {
+            attempts_[i]++;
+        } else {
+            attempts_[i] = 0;
+            queued_at_[i] = write.queued_at;
+            copyField(field, write, &in_flight_);
+        }
+        deadline_[i] = now_ms + (CONFIRM_TIMEOUT << attempts_[i]);
+    }
+    in_flight_.dirty |= write.dirty;
+}
+
+void CommandReconciler::onSkipped(const PendingWrite& write) {
+    in_flight_.dirty &= ~write.dirty;
+    retrying_ &= ~write.dirty;
+}
+
+bool CommandReconciler::onReadback(
+    const HeatpumpSettingsModel& unit, uint32_t now_ms, PendingWrite* retry) {
+    if (in_flight_.dirty == 0 || !unit.isValid()) {
+        return false;
+    }
+
+    bool failed = false;
+    for (uint8_t i = 0; i < PendingWrite::FIELD_COUNT; i++) {
+        uint8_t field = 1 << i;
+        if (!(in_flight_.dirty & field)) {
+            continue;
+        }
+
+        if (fieldEquals(field, unit, in_flight_)) {
+            in_flight_.dirty &= ~field;
+            retrying_ &= ~field;
+            confirmed_++;
+            confirm_latency_ms_.record(now_ms - queued_at_[i]);
+            recent_confirm_latency_ms_.record(now_ms - queued_at_[i]);
+        } else if ((retrying_ & field) || static_cast<int32_t>(now_ms - deadline_[i]) < 0) {
+            // Waiting on the unit, or on the retry to be written.
+            suppressed_++;
+        } else if (attempts_[i] < MAX_RETRIES) {
+            ESP_LOGD("CommandReconciler", "Unit didn't confirm %s, writing it again (retry %u)",
+                FIELD_NAMES[i], attempts_[i] + 1);
+            retrying_ |= field;
+            retries_++;
+            copyField(field, in_flight_, retry);
+            retry->dirty |= field;
+        } else {
+            ESP_LOGW("CommandReconciler", "Unit didn't confirm %s after %u retries, using its value",
+                FIELD_NAMES[i], MAX_RETRIES);
+            in_flight_.dirty &= ~field;
+            failures_++;
+            failed = true;
+        }
+    }
+    return failed;
+}
+
+void CommandReconciler::apply(HeatpumpSettingsModel* settings) const {
+    if (in_flight_.dirty == 0 || !settings->isValid()) {
+        return;
+    }
+    in_flight_.applyTo(settings);
+}
+
+uint8_t CommandReconciler::getReverted(
+    const PendingWrite& write, const HeatpumpSettingsModel& unit) const {
+    uint8_t reverted = 0;
+    for (uint8_t i = 0; i < PendingWrite::FIELD_COUNT; i++) {
+        uint8_t field = 1 << i;
+        if ((write.dirty & in_flight_.dirty & field) &&
+            fieldEquals(field, write, unit) && !fieldEquals(field, write, in_flight_)) {
+            reverted |= field;
+        }
+    }
+    return reverted;
+}
+
+void CommandReconciler::onRetryHeld(uint8_t fields, uint32_t now_ms) {
+    for (uint8_t i = 0; i < PendingWrite::FIELD_COUNT; i++) {
+        uint8_t field = 1 << i;
+        if (!(fields & retrying_ & field)) {
+            continue;
+        }
+        retrying_ &= ~field;
+        attempts_[i]++;
+        deadline_[i] = now_ms + (CONFIRM_TIMEOUT << attempts_[i]);
+    }
+}
@@ -0,0 +1,97 @@
+/**
+ * CommandReconciler.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef COMMANDRECONCILER_H
+#define COMMANDRECONCILER_H
+
+#include "HeatpumpSettings.h"
+#include "LinkStatistics.h"
+
+// Verifies written commands against the settings read back from the unit,
+// and keeps those readbacks consistent with commands that were just written.
+//
+// The unit can report its old settings for a few packets after
+// acknowledging a SET, and a SET can be lost entirely. Each written field
+// stays in flight until a readback confirms it, and until then readbacks
+// show the requested value instead of the stale one. Without this the state
+// published to Home Assistant flaps back for a poll or two after every
+// command. A field that isn't confirmed in time is written again, with the
+// timeout doubling on each retry, and given up on after MAX_RETRIES.
+class CommandReconciler {
+public:
+    // Time a written field may go unconfirmed before it's written again.
+    // Doubles on every retry.
+    static const uint32_t CONFIRM_TIMEOUT = 5000; // in milliseconds
+    static const uint8_t MAX_RETRIES = 3;
+
+    // Called after a SET packet carrying the dirty fields of write was sent,
+    // whether or not the unit acknowledged it. A field that's written again
+    // with its in flight value is treated as a retry, anything else replaces
+    // what was in flight.
+    void onWritten(const PendingWrite& write, uint32_t now_ms);
+
+    // Called when a write was skipped because the unit already reports its
+    // dirty fields. Any of them still in flight are done with, so a stale
+    // retry can't be written over the request.
+    void onSkipped(const PendingWrite& write);
+
+    // Called after every sync with the settings read back from the unit.
+    // Confirms in flight fields the unit now reports. Fields past their
+    // timeout are added to retry, or given up on once out of retries.
+    // Returns true if any field was given up on, so the unit's value should
+    // be published again.
+    bool onReadback(const HeatpumpSettingsModel& unit, uint32_t now_ms, PendingWrite* retry);
+
+    // Replaces fields of settings that are still in flight with the values
+    // that were written.
+    void apply(HeatpumpSettingsModel* settings) const;
+
+    // Returns the dirty fields of write that are in flight with another
+    // value, and that unit already reports. Writing them would undo a write
+    // the unit hasn't confirmed, while its readback may still be stale.
+    uint8_t getReverted(const PendingWrite& write, const HeatpumpSettingsModel& unit) const;
+
+    // Called instead of onWritten() for fields handed out for a retry that
+    // weren't written again. They wait another, doubled, timeout for the
+    // unit as if they had been.
+    void onRetryHeld(uint8_t fields, uint32_t now_ms);
+
+    bool hasInFlight() const { return in_flight_.dirty != 0; }
+    // PendingWrite fields written but not yet confirmed by the unit.
+    uint8_t getInFlight() const { return in_flight_.dirty; }
+
+    uint32_t getConfirmed() const { return confirmed_; }
+    uint32_t getRetries() const { return retries_; }
+    uint32_t getFailures() const { return failures_; }
+    uint32_t getSuppressed() const { return suppressed_; }
+
+    // Time from a field being requested until the unit reported it, in
+    // milliseconds, including any retries.
+    const RunningStats& getConfirmLatency() const { return confirm_latency_ms_; }
+    const RecentSamples& getRecentConfirmLatency() const { return recent_confirm_latency_ms_; }
+
+private:
+    // Returns true if field has the same value in a and b.
+    template<typename A, typename B>
+    static bool fieldEquals(uint8_t field, const A& a, const B& b);
+
+    PendingWrite in_flight_;
+    // Fields handed out for a retry, and not yet written again.
+    uint8_t retrying_ = 0;
+    uint32_t queued_at_[PendingWrite::FIELD_COUNT] = {};
+    uint32_t deadline_[PendingWrite::FIELD_COUNT] = {};
+    uint8_t attempts_[PendingWrite::FIELD_COUNT] = {};
+
+    uint32_t confirmed_ = 0;
+    uint32_t retries_ = 0;
+    uint32_t failures_ = 0;
+    uint32_t suppressed_ = 0;
+    RunningStats confirm_latency_ms_;
+    RecentSamples recent_confirm_latency_ms_;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * ConnectionMonitor.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "ConnectionMonitor.h"
+#include "esphome.h"
+
+using esphome::esp_log_printf_;
+
+static const char* const CONNECTION_STATE_NAMES[] = {
+    "DISCONNECTED", "AWAITING_SETTINGS", "ESTABLISHED"
+};
+
+void ConnectionMonitor::begin(uint32_t now_ms) {
+    state_ = CONNECTION_DISCONNECTED;
+    started_at_ = now_ms;
+    next_attempt_at_ = now_ms;
+    backoff_ = INITIAL_BACKOFF;
+}
+
+bool ConnectionMonitor::shouldConnect(uint32_t now_ms) const {
+    return state_ == CONNECTION_DISCONNECTED &&
+        static_cast<int32_t>(now_ms - next_attempt_at_) >= 0;
+}
+
+void ConnectionMonitor::onConnectResult(bool connected, uint32_t now_ms) {
+    attempts_++;
+    if (!connected) {
+        failures_++;
+        retryLater(now_ms);
+        return;
+    }
+    state_ = CONNECTION_AWAITING_SETTINGS;
+    awaiting_since_ = now_ms;
+}
+
+void ConnectionMonitor::onSync(bool connected, bool settings_valid, uint32_t now_ms) {
+    switch (state_) {
+        case CONNECTION_AWAITING_SETTINGS:
+            if (settings_valid) {
+                state_ = CONNECTION_ESTABLISHED;
+                backoff_ = INITIAL_BACKOFF;
+                if (was_established_) {
+                    reconnects_++;
+                    ESP_LOGI("ConnectionMonitor", "Reconnected to heatpump (%u reconnects)", reconnects_);
+                } else {
+                    was_established_ = true;
+                    time_to_first_settings_ = now_ms - started_at_;
+                    ESP_LOGI("ConnectionMonitor", "First settings read %u ms after boot, %u attempts",
+                        time_to_first_settings_, attempts_);
+                }
+            } else if (now_ms - awaiting_since_ >= SETTINGS_TIMEOUT) {
+                failures_++;
+                retryLater(now_ms);
+            }
+            break;
+        case CONNECTION_ESTABLISHED:
+            if (!connected) {
+                ESP_LOGW("ConnectionMonitor", "Lost connection to heatpump, reconnecting");
+                state_ = CONNECTION_DISCONNECTED;
+                next_attempt_at_ = now_ms;
+            }
+            break;
+        case CONNECTION_DISCONNECTED:
+            break;
+    }
+}
+
+const char* ConnectionMonitor::stateName(ConnectionState state) {
+    return CONNECTION_STATE_NAMES[state];
+}
+
+void ConnectionMonitor::retryLater(uint32_t now_ms) {
+    ESP_LOGW("ConnectionMonitor", "Heatpump not responding, retrying in %u ms", backoff_);
+    state_ = CONNECTION_DISCONNECTED;
+    next_attempt_at_ = now_ms + backoff_;
+    backoff_ = backoff_ * 2 > MAX_BACKOFF ? MAX_BACKOFF : backoff_ * 2;
+}
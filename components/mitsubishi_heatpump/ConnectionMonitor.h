@@ -0,0 +1,81 @@
+/**
+ * ConnectionMonitor.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef CONNECTIONMONITOR_H
+#define CONNECTIONMONITOR_H
+
+#include <stdint.h>
+
+enum ConnectionState : uint8_t {
+    // Waiting for the next connection attempt.
+    CONNECTION_DISCONNECTED,
+    // Connected, waiting for the unit to report its settings.
+    CONNECTION_AWAITING_SETTINGS,
+    // The unit has reported valid settings.
+    CONNECTION_ESTABLISHED,
+};
+
+// Tracks the connection to the heatpump from the main loop, instead of
+// connecting once in setup().
+//
+// Failed attempts, and connections that never report settings, are retried
+// with exponential backoff, so a unit that's slow to answer after a power
+// cut neither fails the component nor stalls the loop. A link lost after
+// being established is retried straight away.
+class ConnectionMonitor {
+public:
+    static const uint32_t INITIAL_BACKOFF = 1000; // in milliseconds
+    static const uint32_t MAX_BACKOFF = 60000; // in milliseconds
+
+    // Time allowed for the first settings after a successful connect.
+    static const uint32_t SETTINGS_TIMEOUT = 10000; // in milliseconds
+
+    // Called from setup(). The first attempt is due immediately.
+    void begin(uint32_t now_ms);
+
+    // Returns true if a connection attempt is due.
+    bool shouldConnect(uint32_t now_ms) const;
+
+    // Called with the result of each HeatPump::connect().
+    void onConnectResult(bool connected, uint32_t now_ms);
+
+    // Called after every sync with the library's connection flag and whether
+    // the unit's settings have been read.
+    void onSync(bool connected, bool settings_valid, uint32_t now_ms);
+
+    // Sync and writes are only attempted once connected.
+    bool canSync() const { return state_ != CONNECTION_DISCONNECTED; }
+    bool isEstablished() const { return state_ == CONNECTION_ESTABLISHED; }
+    ConnectionState getState() const { return state_; }
+    static const char* stateName(ConnectionState state);
+
+    uint32_t getAttempts() const { return attempts_; }
+    uint32_t getFailures() const { return failures_; }
+    uint32_t getReconnects() const { return reconnects_; }
+    uint32_t getBackoff() const { return backoff_; }
+
+    // Time from begin() until the first valid settings, in milliseconds, or
+    // 0 if they haven't been read yet.
+    uint32_t getTimeToFirstSettings() const { return time_to_first_settings_; }
+
+private:
+    void retryLater(uint32_t now_ms);
+
+    ConnectionState state_ = CONNECTION_DISCONNECTED;
+    uint32_t started_at_ = 0;
+    uint32_t next_attempt_at_ = 0;
+    uint32_t awaiting_since_ = 0;
+    uint32_t backoff_ = INITIAL_BACKOFF;
+    bool was_established_ = false;
+
+    uint32_t attempts_ = 0;
+    uint32_t failures_ = 0;
+    uint32_t reconnects_ = 0;
+    uint32_t time_to_first_settings_ = 0;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * DeadlineScheduler.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "DeadlineScheduler.h"
+#include "esphome.h"
+
+using esphome::esp_log_printf_;
+
+const char* DeadlineScheduler::name(DeadlineId id) {
+    switch (id) {
+        case DEADLINE_PING:
+            return "ping timeout";
+        case DEADLINE_REMOTE_TEMPERATURE:
+            return "remote temperature timeout";
+        case DEADLINE_ZONE_EXPIRY:
+            return "zone expiry";
+        case DEADLINE_SENSOR_EXPIRY:
+            return "sensor expiry";
+        default:
+            return "unknown";
+    }
+}
+
+void DeadlineScheduler::schedule(DeadlineId id, uint32_t due_ms) {
+    remove(id);
+
+    // Insert keeping order_ sorted by due time. Compare relative to the
+    // earliest deadline so this stays correct across millis() wrapping.
+    uint32_t base = count_ > 0 ? due_[order_[0]] : due_ms;
+    if (static_cast<int32_t>(due_ms - base) < 0) {
+        base = due_ms;
+    }
+    uint8_t position = count_;
+    while (position > 0 && due_[order_[position - 1]] - base > due_ms - base) {
+        order_[position] = order_[position - 1];
+        position--;
+    }
+    order_[position] = id;
+    count_++;
+
+    scheduled_[id] = true;
+    due_[id] = due_ms;
+}
+
+void DeadlineScheduler::cancel(DeadlineId id) {
+    remove(id);
+}
+
+uint8_t DeadlineScheduler::runExpired(uint32_t now_ms) {
+    uint8_t run = 0;
+    while (count_ > 0 && isDue(due_[order_[0]], now_ms)) {
+        DeadlineId id = order_[0];
+        remove(id);
+        run++;
+        if (handlers_[id]) {
+            handlers_[id]();
+        }
+    }
+    return run;
+}
+
+bool DeadlineScheduler::nextDeadline(DeadlineId* id, uint32_t* due_ms) const {
+    if (count_ == 0) {
+        return false;
+    }
+    *id = order_[0];
+    *due_ms = due_[order_[0]];
+    return true;
+}
+
+void DeadlineScheduler::log(const char* tag, uint32_t now_ms) const {
+    if (count_ == 0) {
+        ESP_LOGD(tag, "Deadlines: none pending");
+        return;
+    }
+    for (uint8_t i = 0; i < count_; i++) {
+        DeadlineId id = order_[i];
+        ESP_LOGD(tag, "Deadlines: %s in %d s", name(id),
+            static_cast<int32_t>(due_[id] - now_ms) / 1000);
+    }
+}
+
+void DeadlineScheduler::remove(DeadlineId id) {
+    if (!scheduled_[id]) {
+        return;
+    }
+    scheduled_[id] = false;
+
+    uint8_t position = 0;
+    while (order_[position] != id) {
+        position++;
+    }
+    count_--;
+    for (; position < count_; position++) {
+        order_[position] = order_[position + 1];
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * DeadlineScheduler.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef DEADLINESCHEDULER_H
+#define DEADLINESCHEDULER_H
+
+#include <functional>
+#include <stdint.h>
+
+// Timers owned by the component. Add new timers here.
+enum DeadlineId : uint8_t {
+    // No ping received within remote_temperature_ping_timeout_minutes.
+    DEADLINE_PING,
+    // No remote temperature received within the operating or idle timeout.
+    DEADLINE_REMOTE_TEMPERATURE,
+    // The neighboring zone that reported least recently goes stale.
+    DEADLINE_ZONE_EXPIRY,
+    // The remote sensor that reported least recently goes stale.
+    DEADLINE_SENSOR_EXPIRY,
+    DEADLINE_COUNT
+};
+
+// One shot deadlines, each with a handler run once it has passed.
+//
+// Pending deadlines are kept in due order, so checking for expired
+// deadlines only looks at the earliest one and costs O(expired) rather than
+// O(timers). Times are millis() values and may wrap.
+class DeadlineScheduler {
+public:
+    typedef std::function<void()> Handler;
+
+    static const char* name(DeadlineId id);
+
+    void setHandler(DeadlineId id, Handler handler) { handlers_[id] = handler; }
+
+    // Schedules the deadline, replacing any pending one with the same id.
+    void schedule(DeadlineId id, uint32_t due_ms);
+    void cancel(DeadlineId id);
+    bool isScheduled(DeadlineId id) const { return scheduled_[id]; }
+
+    // Runs the handler of every deadline that has passed, earliest first.
+    // Handlers may schedule deadlines again. Returns the number run.
+    uint8_t runExpired(uint32_t now_ms);
+
+    // Returns false if nothing is scheduled, otherwise the earliest deadline.
+    bool nextDeadline(DeadlineId* id, uint32_t* due_ms) const;
+
+    // Writes every pending deadline to the log.
+    void log(const char* tag, uint32_t now_ms) const;
+
+private:
+    static bool isDue(uint32_t due_ms, uint32_t now_ms) {
+        return static_cast<int32_t>(now_ms - due_ms) >= 0;
+    }
+
+    void remove(DeadlineId id);
+
+    Handler handlers_[DEADLINE_COUNT];
+    bool scheduled_[DEADLINE_COUNT] = {};
+    uint32_t due_[DEADLINE_COUNT] = {};
+    // Scheduled ids, earliest due first.
+    DeadlineId order_[DEADLINE_COUNT];
+    uint8_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * HeatpumpSettings.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "HeatpumpSettings.h"
+
+void PendingWrite::applyTo(HeatpumpSettingsModel* settings) const {
+    if (dirty & POWER) {
+        settings->power = power;
+    }
+    if (dirty & MODE) {
+        settings->mode = mode;
+    }
+    if (dirty & TEMPERATURE) {
+        settings->temperature = temperature;
+    }
+    if (dirty & FAN) {
+        settings->fan = fan;
+    }
+    if (dirty & VANE) {
+        settings->vane = vane;
+    }
+    if (dirty & WIDE_VANE) {
+        settings->wideVane = wideVane;
+    }
+}
+
+HeatpumpSettingsModel HeatpumpSettingsParser::parse(const heatpumpSettings& settings) {
+    HeatpumpSettingsModel result;
+    result.power = lookup(power_, HEATPUMP_POWER_NAMES, settings.power);
+    result.mode = lookup(mode_, HEATPUMP_MODE_NAMES, settings.mode);
+    result.temperature = settings.temperature;
+    result.fan = lookup(fan_, HEATPUMP_FAN_NAMES, settings.fan);
+    result.vane = lookup(vane_, HEATPUMP_VANE_NAMES, settings.vane);
+    result.wideVane = lookup(wide_vane_, HEATPUMP_WIDE_VANE_NAMES, settings.wideVane);
+    result.iSee = settings.iSee;
+    result.connected = settings.connected;
+    return result;
+}
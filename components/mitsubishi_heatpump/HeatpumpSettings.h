@@ -0,0 +1,175 @@
+/**
+ * HeatpumpSettings.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef HEATPUMPSETTINGS_H
+#define HEATPUMPSETTINGS_H
+
+#include "HeatPump.h"
+
+// Enum equivalents of the strings used by the HeatPump library. The order of
+// each enum matches the library's *_MAP tables, so a value can be used to
+// index the name tables below.
+enum class HeatpumpPowerSetting : uint8_t {
+    OFF,
+    ON,
+    UNKNOWN
+};
+
+enum class HeatpumpModeSetting : uint8_t {
+    HEAT,
+    DRY,
+    COOL,
+    FAN,
+    AUTO,
+    // Not a mode understood by the unit, the heatpump is managed by
+    // TwoPointHeatPump switching between HEAT and COOL.
+    DUAL_POINT,
+    UNKNOWN
+};
+
+enum class HeatpumpFanSetting : uint8_t {
+    AUTO,
+    QUIET,
+    SPEED_1,
+    SPEED_2,
+    SPEED_3,
+    SPEED_4,
+    UNKNOWN
+};
+
+enum class HeatpumpVaneSetting : uint8_t {
+    AUTO,
+    POSITION_1,
+    POSITION_2,
+    POSITION_3,
+    POSITION_4,
+    POSITION_5,
+    SWING,
+    UNKNOWN
+};
+
+enum class HeatpumpWideVaneSetting : uint8_t {
+    LEFT_LEFT,
+    LEFT,
+    CENTER,
+    RIGHT,
+    RIGHT_RIGHT,
+    LEFT_RIGHT,
+    SWING,
+    UNKNOWN
+};
+
+// Library strings, indexed by enum value. The last entry of each table is the
+// name logged for UNKNOWN.
+static const char* const HEATPUMP_POWER_NAMES[] = {"OFF", "ON", "UNKNOWN"};
+static const char* const HEATPUMP_MODE_NAMES[] = {"HEAT", "DRY", "COOL", "FAN", "AUTO", "DUAL_POINT", "UNKNOWN"};
+static const char* const HEATPUMP_FAN_NAMES[] = {"AUTO", "QUIET", "1", "2", "3", "4", "UNKNOWN"};
+static const char* const HEATPUMP_VANE_NAMES[] = {"AUTO", "1", "2", "3", "4", "5", "SWING", "UNKNOWN"};
+static const char* const HEATPUMP_WIDE_VANE_NAMES[] = {"<<", "<", "|", ">", ">>", "<>", "SWING", "UNKNOWN"};
+
+inline const char* toString(HeatpumpPowerSetting value) { return HEATPUMP_POWER_NAMES[static_cast<uint8_t>(value)]; }
+inline const char* toString(HeatpumpModeSetting value) { return HEATPUMP_MODE_NAMES[static_cast<uint8_t>(value)]; }
+inline const char* toString(HeatpumpFanSetting value) { return HEATPUMP_FAN_NAMES[static_cast<uint8_t>(value)]; }
+inline const char* toString(HeatpumpVaneSetting value) { return HEATPUMP_VANE_NAMES[static_cast<uint8_t>(value)]; }
+inline const char* toString(HeatpumpWideVaneSetting value) { return HEATPUMP_WIDE_VANE_NAMES[static_cast<uint8_t>(value)]; }
+
+// Compact, enum based equivalent of the library's heatpumpSettings.
+struct HeatpumpSettingsModel {
+    HeatpumpPowerSetting power = HeatpumpPowerSetting::UNKNOWN;
+    HeatpumpModeSetting mode = HeatpumpModeSetting::UNKNOWN;
+    float temperature = 0;
+    HeatpumpFanSetting fan = HeatpumpFanSetting::UNKNOWN;
+    HeatpumpVaneSetting vane = HeatpumpVaneSetting::UNKNOWN;
+    HeatpumpWideVaneSetting wideVane = HeatpumpWideVaneSetting::UNKNOWN;
+    bool iSee = false;
+    bool connected = false;
+
+    // False until the settings have been read from the unit for the first
+    // time.
+    bool isValid() const { return power != HeatpumpPowerSetting::UNKNOWN; }
+};
+
+// Settings requested since the last write to the heatpump. Every setter
+// marks its field dirty, and all dirty fields are sent in a single SET packet
+// on the next updateIfChangesPending().
+struct PendingWrite {
+    static const uint8_t POWER = 1 << 0;
+    static const uint8_t MODE = 1 << 1;
+    static const uint8_t TEMPERATURE = 1 << 2;
+    static const uint8_t FAN = 1 << 3;
+    static const uint8_t VANE = 1 << 4;
+    static const uint8_t WIDE_VANE = 1 << 5;
+    static const uint8_t FIELD_COUNT = 6;
+
+    uint8_t dirty = 0;
+    // When the first of the dirty fields was requested.
+    uint32_t queued_at = 0;
+    HeatpumpPowerSetting power = HeatpumpPowerSetting::UNKNOWN;
+    HeatpumpModeSetting mode = HeatpumpModeSetting::UNKNOWN;
+    float temperature = 0;
+    HeatpumpFanSetting fan = HeatpumpFanSetting::UNKNOWN;
+    HeatpumpVaneSetting vane = HeatpumpVaneSetting::UNKNOWN;
+    HeatpumpWideVaneSetting wideVane = HeatpumpWideVaneSetting::UNKNOWN;
+
+    void markDirty(uint8_t field, uint32_t now_ms) {
+        if (dirty == 0) {
+            queued_at = now_ms;
+        }
+        dirty |= field;
+    }
+
+    // Replaces the dirty fields of settings with the values in this write.
+    void applyTo(HeatpumpSettingsModel* settings) const;
+};
+
+// Converts the library's heatpumpSettings into a HeatpumpSettingsModel.
+//
+// The HeatPump library hands out pointers into its own lookup tables, so the
+// last pointer seen for each field is remembered along with its enum value.
+// Once warmed up, parsing costs a pointer comparison per field rather than a
+// chain of string comparisons.
+class HeatpumpSettingsParser {
+public:
+    HeatpumpSettingsModel parse(const heatpumpSettings& settings);
+
+private:
+    template<typename T>
+    struct CachedField {
+        const char* raw = nullptr;
+        T value = T::UNKNOWN;
+    };
+
+    template<typename T, size_t N>
+    static T lookup(CachedField<T>& cache, const char* const (&names)[N], const char* raw) {
+        if (raw == nullptr) {
+            return T::UNKNOWN;
+        }
+        if (raw == cache.raw) {
+            return cache.value;
+        }
+
+        T value = T::UNKNOWN;
+        for (size_t i = 0; i < N - 1; i++) {
+            if (strcmp(names[i], raw) == 0) {
+                value = static_cast<T>(i);
+                break;
+            }
+        }
+
+        cache.raw = raw;
+        cache.value = value;
+        return value;
+    }
+
+    CachedField<HeatpumpPowerSetting> power_;
+    CachedField<HeatpumpModeSetting> mode_;
+    CachedField<HeatpumpFanSetting> fan_;
+    CachedField<HeatpumpVaneSetting> vane_;
+    CachedField<HeatpumpWideVaneSetting> wide_vane_;
+};
+
+#endif
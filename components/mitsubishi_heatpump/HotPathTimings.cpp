@@ -0,0 +1,78 @@
+/**
+ * HotPathTimings.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "HotPathTimings.h"
+#include "esphome.h"
+
+using esphome::esp_log_printf_;
+
+const uint32_t PhaseTiming::BUCKET_LIMITS[PhaseTiming::BUCKETS - 1] = {
+    100, 1000, 5000, 10000, 30000
+};
+
+void PhaseTiming::record(uint32_t elapsed_us) {
+    total.record(elapsed_us);
+    if (elapsed_us > window_max) {
+        window_max = elapsed_us;
+    }
+
+    uint8_t bucket = 0;
+    while (bucket < BUCKETS - 1 && elapsed_us >= BUCKET_LIMITS[bucket]) {
+        bucket++;
+    }
+    histogram[bucket]++;
+}
+
+uint32_t PhaseTiming::takeWindowMax() {
+    uint32_t result = window_max;
+    window_max = 0;
+    return result;
+}
+
+const char* HotPathTimings::phaseName(TimingPhase phase) {
+    switch (phase) {
+        case TIMING_UPDATE:
+            return "update()";
+        case TIMING_SYNC:
+            return "sync()";
+        case TIMING_WRITE:
+            return "write";
+        case TIMING_DEADLINES:
+            return "deadlines";
+        case TIMING_CONTROL:
+            return "control()";
+        case TIMING_SETTINGS_CALLBACK:
+            return "settings callback";
+        case TIMING_STATUS_CALLBACK:
+            return "status callback";
+        default:
+            return "unknown";
+    }
+}
+
+void HotPathTimings::log(const char* tag) const {
+    ESP_LOGD(tag, "Timing (us): min/avg/max, calls <100us/<1ms/<5ms/<10ms/<30ms/slower");
+    for (uint8_t i = 0; i < TIMING_PHASE_COUNT; i++) {
+        const PhaseTiming& timing = phases_[i];
+        if (timing.total.count == 0) {
+            continue;
+        }
+        ESP_LOGD(tag, "  %-17s %u/%u/%u, %u/%u/%u/%u/%u/%u",
+            phaseName(static_cast<TimingPhase>(i)),
+            timing.total.min, timing.total.average(), timing.total.max,
+            timing.histogram[0], timing.histogram[1], timing.histogram[2],
+            timing.histogram[3], timing.histogram[4], timing.histogram[5]);
+    }
+}
+
+ScopedTiming::ScopedTiming(HotPathTimings& timings, TimingPhase phase)
+    : timings_(timings), phase_(phase), start_(micros()) {
+}
+
+ScopedTiming::~ScopedTiming() {
+    timings_.record(phase_, micros() - start_);
+}
@@ -0,0 +1,72 @@
+/**
+ * HotPathTimings.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef HOTPATHTIMINGS_H
+#define HOTPATHTIMINGS_H
+
+#include "LinkStatistics.h"
+
+// Code paths that run on ESPHome's main loop. The settings and status
+// callbacks are invoked from within HeatPump::sync(), so their time is also
+// included in TIMING_SYNC.
+enum TimingPhase {
+    TIMING_UPDATE,
+    TIMING_SYNC,
+    TIMING_WRITE,
+    TIMING_DEADLINES,
+    TIMING_CONTROL,
+    TIMING_SETTINGS_CALLBACK,
+    TIMING_STATUS_CALLBACK,
+    TIMING_PHASE_COUNT
+};
+
+// Distribution of the time spent in a single phase.
+struct PhaseTiming {
+    // Bucket upper bounds in microseconds, the last bucket holds everything
+    // slower. ESPHome warns about components blocking the loop for longer
+    // than 30 ms.
+    static const uint8_t BUCKETS = 6;
+    static const uint32_t BUCKET_LIMITS[BUCKETS - 1];
+
+    RunningStats total;
+    uint32_t histogram[BUCKETS] = {};
+    // Slowest call since the last takeWindowMax().
+    uint32_t window_max = 0;
+
+    void record(uint32_t elapsed_us);
+    uint32_t takeWindowMax();
+};
+
+// Microseconds per call of each hot path phase, so regressions against
+// ESPHome's loop time budget can be seen on a live unit.
+class HotPathTimings {
+public:
+    static const char* phaseName(TimingPhase phase);
+
+    void record(TimingPhase phase, uint32_t elapsed_us) { phases_[phase].record(elapsed_us); }
+    PhaseTiming& operator[](TimingPhase phase) { return phases_[phase]; }
+
+    // Writes min/avg/max and the histogram of every phase to the log.
+    void log(const char* tag) const;
+
+private:
+    PhaseTiming phases_[TIMING_PHASE_COUNT];
+};
+
+// Records the time until it goes out of scope against a phase.
+class ScopedTiming {
+public:
+    ScopedTiming(HotPathTimings& timings, TimingPhase phase);
+    ~ScopedTiming();
+
+private:
+    HotPathTimings& timings_;
+    TimingPhase phase_;
+    uint32_t start_;
+};
+
+#endif
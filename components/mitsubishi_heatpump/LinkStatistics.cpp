@@ -0,0 +1,111 @@
+/**
+ * LinkStatistics.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "LinkStatistics.h"
+#include "esphome.h"
+
+using esphome::esp_log_printf_;
+
+void RunningStats::record(uint32_t sample) {
+    if (count == 0 || sample < min) {
+        min = sample;
+    }
+    if (count == 0 || sample > max) {
+        max = sample;
+    }
+    count++;
+    total += sample;
+}
+
+uint32_t RunningStats::average() const {
+    if (count == 0) {
+        return 0;
+    }
+    return total / count;
+}
+
+void RunningStats::reset() {
+    count = 0;
+    min = 0;
+    max = 0;
+    total = 0;
+}
+
+void RecentSamples::record(uint32_t sample) {
+    samples_[next_] = sample;
+    next_ = (next_ + 1) % CAPACITY;
+    if (count_ < CAPACITY) {
+        count_++;
+    }
+}
+
+uint32_t RecentSamples::percentile(uint8_t percent) const {
+    if (count_ == 0) {
+        return 0;
+    }
+
+    uint32_t sorted[CAPACITY];
+    for (uint8_t i = 0; i < count_; i++) {
+        uint32_t sample = samples_[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > sample; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = sample;
+    }
+
+    // Nearest rank.
+    uint8_t rank = (percent * count_ + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+void LinkStatistics::onPacket(const char* packetDirection) {
+    if (strcmp(packetDirection, "packetSent") == 0) {
+        packets_sent_++;
+    } else {
+        packets_received_++;
+    }
+
+    if (command_in_flight_) {
+        command_packets_++;
+    }
+}
+
+void LinkStatistics::onCommandQueued(uint32_t now_ms) {
+    if (command_in_flight_) {
+        // Several control() calls before the next write are coalesced into a
+        // single command, measure latency from the first one.
+        return;
+    }
+
+    command_in_flight_ = true;
+    command_queued_at_ms_ = now_ms;
+    command_packets_ = 0;
+}
+
+void LinkStatistics::onCommandWritten(uint32_t now_ms, bool acknowledged) {
+    if (!command_in_flight_) {
+        return;
+    }
+
+    command_in_flight_ = false;
+    packets_per_command_.record(command_packets_);
+    if (acknowledged) {
+        ack_latency_ms_.record(now_ms - command_queued_at_ms_);
+    } else {
+        commands_unacknowledged_++;
+    }
+}
+
+void LinkStatistics::log(const char* tag) const {
+    ESP_LOGD(tag, "Link: %u packets sent, %u received, %u commands unacknowledged",
+        packets_sent_, packets_received_, commands_unacknowledged_);
+    ESP_LOGD(tag, "Link: command-to-ack latency min/avg/max %u/%u/%u ms over %u commands",
+        ack_latency_ms_.min, ack_latency_ms_.average(), ack_latency_ms_.max, ack_latency_ms_.count);
+    ESP_LOGD(tag, "Link: packets per command min/avg/max %u/%u/%u",
+        packets_per_command_.min, packets_per_command_.average(), packets_per_command_.max);
+}
@@ -0,0 +1,84 @@
+/**
+ * LinkStatistics.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef LINKSTATISTICS_H
+#define LINKSTATISTICS_H
+
+#include <stdint.h>
+
+// Minimum, average and maximum of a series of samples. Uses constant memory
+// so it can be updated from the hot path.
+struct RunningStats {
+    uint32_t count = 0;
+    uint32_t min = 0;
+    uint32_t max = 0;
+    uint64_t total = 0;
+
+    void record(uint32_t sample);
+    uint32_t average() const;
+    void reset();
+};
+
+// The most recent samples of a series, for percentiles that RunningStats
+// can't provide. Recording is constant time, sorting only happens when a
+// percentile is requested.
+class RecentSamples {
+public:
+    static const uint8_t CAPACITY = 32;
+
+    void record(uint32_t sample);
+    uint8_t size() const { return count_; }
+
+    // Sample at or below which percent of the recent samples fall, or 0 if
+    // there are none.
+    uint32_t percentile(uint8_t percent) const;
+
+private:
+    uint32_t samples_[CAPACITY] = {};
+    uint8_t next_ = 0;
+    uint8_t count_ = 0;
+};
+
+// Counters describing the CN105 link between this controller and the
+// heatpump, so regressions in the polling loop can be measured on a live
+// unit instead of guessed.
+class LinkStatistics {
+public:
+    // Called from the HeatPump packet callback for every packet in either
+    // direction.
+    void onPacket(const char* packetDirection);
+
+    // Called when control() queues a command for the heatpump.
+    void onCommandQueued(uint32_t now_ms);
+
+    // Called once the queued command has been written to the heatpump.
+    // acknowledged is the result reported by HeatPump::update().
+    void onCommandWritten(uint32_t now_ms, bool acknowledged);
+
+    // Writes a summary of the collected statistics to the log.
+    void log(const char* tag) const;
+
+    uint32_t getPacketsSent() const { return packets_sent_; }
+    uint32_t getPacketsReceived() const { return packets_received_; }
+    uint32_t getUnacknowledgedCommands() const { return commands_unacknowledged_; }
+    const RunningStats& getAckLatency() const { return ack_latency_ms_; }
+    const RunningStats& getPacketsPerCommand() const { return packets_per_command_; }
+
+private:
+    uint32_t packets_sent_ = 0;
+    uint32_t packets_received_ = 0;
+    uint32_t commands_unacknowledged_ = 0;
+
+    bool command_in_flight_ = false;
+    uint32_t command_queued_at_ms_ = 0;
+    uint32_t command_packets_ = 0;
+
+    RunningStats ack_latency_ms_;
+    RunningStats packets_per_command_;
+};
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * ModeArbiter.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "ModeArbiter.h"
+#include "esphome.h"
+#include <cmath>
+
+using esphome::esp_log_printf_;
+
+void ModeArbiter::seed(HeatpumpMode mode) {
+    if (mode == HeatpumpMode::HEAT || mode == HeatpumpMode::COOL) {
+        mode_ = mode;
+    } else {
+        mode_ = HeatpumpMode::UNKNOWN;
+    }
+    switch_held_off_ = false;
+}
+
+HeatpumpMode ModeArbiter::decide(
+    float room_temperature,
+    float temperature_low,
+    float temperature_high,
+    uint32_t now_ms) {
+    if (std::isnan(room_temperature)) {
+        return mode_;
+    }
+
+    if (mode_ == HeatpumpMode::UNKNOWN) {
+        // Nothing to protect yet, pick whichever setpoint is closest.
+        if (room_temperature <= temperature_low) {
+            mode_ = HeatpumpMode::HEAT;
+        } else if (room_temperature >= temperature_high) {
+            mode_ = HeatpumpMode::COOL;
+        } else if (fabsf(temperature_low - room_temperature) < fabsf(temperature_high - room_temperature)) {
+            mode_ = HeatpumpMode::HEAT;
+        } else {
+            mode_ = HeatpumpMode::COOL;
+        }
+        return mode_;
+    }
+
+    // Between the deadbanded setpoints the current mode is kept.
+    HeatpumpMode wanted = mode_;
+    if (room_temperature <= temperature_low - config_.deadband) {
+        wanted = HeatpumpMode::HEAT;
+    } else if (room_temperature >= temperature_high + config_.deadband) {
+        wanted = HeatpumpMode::COOL;
+    }
+
+    if (wanted == mode_) {
+        switch_held_off_ = false;
+        return mode_;
+    }
+
+    if (!canSwitch(now_ms)) {
+        if (!switch_held_off_) {
+            switch_held_off_ = true;
+            switches_held_off_++;
+            ESP_LOGD("ModeArbiter", "Holding off switch to %s, compressor %s for %u ms",
+                wanted == HeatpumpMode::HEAT ? "HEAT" : "COOL",
+                compressor_running_ ? "running" : "off",
+                now_ms - compressor_changed_at_);
+        }
+        return mode_;
+    }
+
+    ESP_LOGD("ModeArbiter", "Switching to %s at room temperature %.2f",
+        wanted == HeatpumpMode::HEAT ? "HEAT" : "COOL", room_temperature);
+    mode_ = wanted;
+    last_switch_at_ = now_ms;
+    mode_switches_++;
+    switch_held_off_ = false;
+    return mode_;
+}
+
+void ModeArbiter::onCompressorState(bool running, uint32_t now_ms) {
+    if (compressor_known_ && running == compressor_running_) {
+        return;
+    }
+
+    if (running && compressor_known_) {
+        compressor_starts_++;
+    }
+    compressor_known_ = true;
+    compressor_running_ = running;
+    compressor_changed_at_ = now_ms;
+}
+
+bool ModeArbiter::canSwitch(uint32_t now_ms) const {
+    if (mode_switches_ > 0 && now_ms - last_switch_at_ < config_.switch_cooldown_ms) {
+        return false;
+    }
+
+    if (!compressor_known_) {
+        return true;
+    }
+
+    uint32_t dwell = now_ms - compressor_changed_at_;
+    if (compressor_running_) {
+        return dwell >= config_.min_run_time_ms;
+    }
+    return dwell >= config_.min_off_time_ms;
+}
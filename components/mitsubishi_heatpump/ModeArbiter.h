@@ -0,0 +1,83 @@
+/**
+ * ModeArbiter.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef MODEARBITER_H
+#define MODEARBITER_H
+
+#include <stdint.h>
+
+enum HeatpumpMode {
+    UNKNOWN,
+    OFF,
+    COOL,
+    HEAT
+};
+
+struct ModeArbiterConfig {
+    // How far the room must move past the opposite setpoint before switching
+    // between HEAT and COOL, in degrees C.
+    float deadband = 0.5;
+    // Minimum time the compressor runs before a mode switch may interrupt it.
+    uint32_t min_run_time_ms = 5 * 60 * 1000;
+    // Minimum time the compressor rests before a mode switch may restart it
+    // in the opposite direction.
+    uint32_t min_off_time_ms = 3 * 60 * 1000;
+    // Minimum time between two mode switches.
+    uint32_t switch_cooldown_ms = 10 * 60 * 1000;
+};
+
+// Chooses between HEAT and COOL in managed dual point mode.
+//
+// Switching is subject to a deadband around the setpoints, and is held off
+// until the compressor has satisfied its minimum run or off time and the
+// switch cooldown has elapsed, so the unit doesn't short cycle when the room
+// sits close to one of the setpoints.
+class ModeArbiter {
+public:
+    void setConfig(const ModeArbiterConfig& config) { config_ = config; }
+    const ModeArbiterConfig& getConfig() const { return config_; }
+
+    // Starts arbitrating from the given mode, e.g. whatever the unit is
+    // already doing when managed mode is enabled. Doesn't count as a switch.
+    void seed(HeatpumpMode mode);
+
+    // Returns the mode the unit should be in, switching if the room has moved
+    // past the opposite setpoint and a switch is currently allowed.
+    HeatpumpMode decide(float room_temperature,
+                        float temperature_low,
+                        float temperature_high,
+                        uint32_t now_ms);
+
+    // Called whenever the unit reports whether the compressor is running.
+    void onCompressorState(bool running, uint32_t now_ms);
+
+    uint32_t getModeSwitches() const { return mode_switches_; }
+    uint32_t getCompressorStarts() const { return compressor_starts_; }
+    // Times a switch was wanted but held off by the dwell times.
+    uint32_t getSwitchesHeldOff() const { return switches_held_off_; }
+
+private:
+    bool canSwitch(uint32_t now_ms) const;
+
+    ModeArbiterConfig config_;
+    HeatpumpMode mode_ = HeatpumpMode::UNKNOWN;
+    uint32_t last_switch_at_ = 0;
+
+    bool compressor_known_ = false;
+    bool compressor_running_ = false;
+    uint32_t compressor_changed_at_ = 0;
+
+    // Whether a held off switch has already been counted, so a switch held
+    // off for many syncs counts once.
+    bool switch_held_off_ = false;
+
+    uint32_t mode_switches_ = 0;
+    uint32_t compressor_starts_ = 0;
+    uint32_t switches_held_off_ = 0;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * PacketTrace.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "PacketTrace.h"
+#include <string.h>
+
+using esphome::esp_log_printf_;
+
+static const uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+static const uint16_t PCAP_VERSION_MAJOR = 2;
+static const uint16_t PCAP_VERSION_MINOR = 4;
+static const uint32_t PCAP_LINKTYPE_USER0 = 147;
+
+static void writeU16(Print& out, uint16_t value) {
+    uint8_t bytes[2] = {
+        static_cast<uint8_t>(value),
+        static_cast<uint8_t>(value >> 8)};
+    out.write(bytes, sizeof(bytes));
+}
+
+static void writeU32(Print& out, uint32_t value) {
+    uint8_t bytes[4] = {
+        static_cast<uint8_t>(value),
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value >> 16),
+        static_cast<uint8_t>(value >> 24)};
+    out.write(bytes, sizeof(bytes));
+}
+
+void PacketTrace::record(uint32_t now_ms, const char* packetDirection, const uint8_t* packet, unsigned int length) {
+    TracedPacket& slot = packets_[next_];
+    slot.timestamp_ms = now_ms;
+    // The library only ever passes "packetSent" or "packetRecv".
+    slot.direction = packetDirection[6] == 'S' ? TracedPacket::SENT : TracedPacket::RECEIVED;
+    slot.length = length > 0xFF ? 0xFF : length;
+    memcpy(slot.data, packet, slot.capturedLength());
+
+    next_ = (next_ + 1) % CAPACITY;
+    if (size_ < CAPACITY) {
+        size_++;
+    } else {
+        dropped_++;
+    }
+}
+
+void PacketTrace::dumpHex(const char* tag) const {
+    ESP_LOGI(tag, "Packet trace: %u packets, %u older packets dropped", size_, dropped_);
+
+    char hex[HEX_LENGTH];
+    for (uint8_t i = 0; i < size_; i++) {
+        const TracedPacket& packet = at(i);
+        formatHex(packet.data, packet.capturedLength(), hex);
+        ESP_LOGI(tag, "  %10u %s %s",
+            packet.timestamp_ms,
+            packet.direction == TracedPacket::SENT ? "TX" : "RX",
+            hex);
+    }
+}
+
+void PacketTrace::writePcap(Print& out) const {
+    writeU32(out, PCAP_MAGIC);
+    writeU16(out, PCAP_VERSION_MAJOR);
+    writeU16(out, PCAP_VERSION_MINOR);
+    writeU32(out, 0); // GMT offset
+    writeU32(out, 0); // timestamp accuracy
+    writeU32(out, TracedPacket::MAX_LENGTH + 1); // snapshot length
+    writeU32(out, PCAP_LINKTYPE_USER0);
+
+    for (uint8_t i = 0; i < size_; i++) {
+        const TracedPacket& packet = at(i);
+        uint8_t captured = packet.capturedLength();
+        // Timestamps are relative to boot.
+        writeU32(out, packet.timestamp_ms / 1000);
+        writeU32(out, (packet.timestamp_ms % 1000) * 1000);
+        writeU32(out, captured + 1);
+        writeU32(out, packet.length + 1);
+        out.write(&packet.direction, 1);
+        out.write(packet.data, captured);
+    }
+}
+
+void PacketTrace::clear() {
+    next_ = 0;
+    size_ = 0;
+    dropped_ = 0;
+}
+
+void PacketTrace::formatHex(const uint8_t* data, unsigned int length, char* buffer) {
+    static const char DIGITS[] = "0123456789ABCDEF";
+
+    if (length > TracedPacket::MAX_LENGTH) {
+        length = TracedPacket::MAX_LENGTH;
+    }
+
+    char* out = buffer;
+    for (unsigned int i = 0; i < length; i++) {
+        *out++ = DIGITS[data[i] >> 4];
+        *out++ = DIGITS[data[i] & 0x0F];
+        *out++ = ' ';
+    }
+    *out = '\0';
+}
+
+const TracedPacket& PacketTrace::at(uint8_t index) const {
+    uint8_t oldest = size_ < CAPACITY ? 0 : next_;
+    return packets_[(oldest + index) % CAPACITY];
+}
@@ -0,0 +1,73 @@
+/**
+ * PacketTrace.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef PACKETTRACE_H
+#define PACKETTRACE_H
+
+#include "esphome.h"
+
+// A single packet captured on the CN105 link.
+struct TracedPacket {
+    // Longest packet exchanged with the unit. Longer packets are truncated.
+    static const uint8_t MAX_LENGTH = 22;
+
+    static const uint8_t SENT = 0;
+    static const uint8_t RECEIVED = 1;
+
+    uint32_t timestamp_ms;
+    uint8_t direction;
+    // Length of the packet on the wire, data holds at most MAX_LENGTH bytes.
+    uint8_t length;
+    uint8_t data[MAX_LENGTH];
+
+    uint8_t capturedLength() const { return length < MAX_LENGTH ? length : MAX_LENGTH; }
+};
+
+// Fixed size ring buffer of the most recent packets in both directions.
+//
+// Capturing a packet is a single copy into a preallocated slot, so tracing
+// can stay enabled in production. The trace can then be dumped on demand,
+// either as hex to the log or as a pcap capture for offline analysis.
+class PacketTrace {
+public:
+    static const uint8_t CAPACITY = 32;
+
+    // Hex dump of a packet, "FC 41 01 ..." including the trailing NUL.
+    static const size_t HEX_LENGTH = TracedPacket::MAX_LENGTH * 3 + 1;
+
+    // Called from the HeatPump packet callback for every packet.
+    void record(uint32_t now_ms, const char* packetDirection, const uint8_t* packet, unsigned int length);
+
+    // Writes every captured packet, oldest first, to the log.
+    void dumpHex(const char* tag) const;
+
+    // Writes every captured packet, oldest first, as a pcap capture using
+    // the LINKTYPE_USER0 link type. Each packet is prefixed by a single byte
+    // holding its direction.
+    void writePcap(Print& out) const;
+
+    void clear();
+
+    uint8_t size() const { return size_; }
+    uint32_t getDropped() const { return dropped_; }
+
+    // Formats up to MAX_LENGTH bytes of a packet into buffer, which must
+    // hold HEX_LENGTH characters.
+    static void formatHex(const uint8_t* data, unsigned int length, char* buffer);
+
+private:
+    // Returns the index'th oldest packet.
+    const TracedPacket& at(uint8_t index) const;
+
+    TracedPacket packets_[CAPACITY];
+    uint8_t next_ = 0;
+    uint8_t size_ = 0;
+    // Packets overwritten by newer ones since the trace was last cleared.
+    uint32_t dropped_ = 0;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * PeerLink.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "PeerLink.h"
+
+using esphome::esp_log_printf_;
+
+// Bound the time spent draining the socket in a single loop() call.
+static const uint8_t PEER_MAX_PACKETS_PER_LOOP = 4;
+
+void PeerLink::configure(uint32_t group, IPAddress address, uint16_t port) {
+    protocol_.setGroup(group);
+    address_ = address;
+    port_ = port;
+    configured_ = true;
+}
+
+void PeerLink::loop() {
+    if (!configured_) {
+        return;
+    }
+
+    if (WiFi.status() != WL_CONNECTED) {
+        // Group membership is lost with the connection, rejoin once it's back.
+        if (joined_) {
+            udp_.stop();
+            joined_ = false;
+        }
+        return;
+    }
+
+    if (!joined_) {
+#ifdef USE_ESP32
+        joined_ = udp_.beginMulticast(address_, port_);
+#else
+        joined_ = udp_.beginMulticast(WiFi.localIP(), address_, port_);
+#endif
+        if (!joined_) {
+            return;
+        }
+        ESP_LOGD("PeerLink", "Joined peer multicast group on port %u", port_);
+    }
+
+    for (uint8_t i = 0; i < PEER_MAX_PACKETS_PER_LOOP; i++) {
+        int length = udp_.parsePacket();
+        if (length <= 0) {
+            break;
+        }
+
+        // Anything longer isn't a report, and is dropped by the next
+        // parsePacket().
+        uint8_t data[sizeof(PeerPacket)];
+        if (length != sizeof(data) || udp_.read(data, sizeof(data)) != sizeof(data)) {
+            continue;
+        }
+        protocol_.receive(data, sizeof(data), millis());
+    }
+}
+
+bool PeerLink::broadcast(
+    bool heat_cool,
+    float temperature_low,
+    float temperature_high,
+    float temperature_current,
+    uint32_t now_ms) {
+    if (!joined_) {
+        return false;
+    }
+
+    PeerPacket packet;
+    if (!protocol_.buildReport(heat_cool, temperature_low, temperature_high,
+                               temperature_current, now_ms, &packet)) {
+        return false;
+    }
+
+#ifdef USE_ESP32
+    if (!udp_.beginMulticastPacket()) {
+#else
+    if (!udp_.beginPacketMulticast(address_, port_, WiFi.localIP())) {
+#endif
+        return false;
+    }
+    udp_.write(reinterpret_cast<const uint8_t*>(&packet), sizeof(packet));
+    if (!udp_.endPacket()) {
+        return false;
+    }
+    protocol_.onSent(packet, now_ms);
+    return true;
+}
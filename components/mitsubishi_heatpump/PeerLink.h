@@ -0,0 +1,69 @@
+/**
+ * PeerLink.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef PEERLINK_H
+#define PEERLINK_H
+
+#include "esphome.h"
+#include "PeerProtocol.h"
+
+#ifdef USE_ESP32
+#include <WiFi.h>
+#else
+#include <ESP8266WiFi.h>
+#endif
+#include <WiFiUdp.h>
+
+// Exchanges dual point state directly between heads over UDP multicast, so
+// multizone negotiation doesn't depend on Home Assistant relaying
+// report_neighbor_temperature calls between every pair of heads.
+//
+// Each head broadcasts its state whenever it changes, and at least every
+// heartbeat interval so neighbors can expire heads that went away. Reports
+// from other heads in the same group are handed to the report callback.
+// Building and validating the reports is left to PeerProtocol, this only
+// moves them over the network.
+class PeerLink {
+public:
+    typedef PeerProtocol::ReportCallback ReportCallback;
+
+    void configure(uint32_t group, IPAddress address, uint16_t port);
+    bool isConfigured() const { return configured_; }
+
+    // Sets the interned id this head reports itself as.
+    void setSender(uint32_t sender) { protocol_.setSender(sender); }
+    uint32_t getSender() const { return protocol_.getSender(); }
+
+    // Sets the zone_weight this head reports.
+    void setWeight(float weight) { protocol_.setWeight(weight); }
+
+    void setReportCallback(ReportCallback callback) { protocol_.setReportCallback(callback); }
+
+    // Joins the multicast group once WiFi is up, and hands any received
+    // reports to the report callback. Call from loop().
+    void loop();
+
+    // Broadcasts this head's state if it changed, or if the heartbeat is due.
+    // Returns true if a report was sent.
+    bool broadcast(bool heat_cool,
+                   float temperature_low,
+                   float temperature_high,
+                   float temperature_current,
+                   uint32_t now_ms);
+
+    const PeerProtocol& getProtocol() const { return protocol_; }
+
+private:
+    bool configured_ = false;
+    bool joined_ = false;
+    IPAddress address_;
+    uint16_t port_ = 0;
+    WiFiUDP udp_;
+    PeerProtocol protocol_;
+};
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * PeerProtocol.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "PeerProtocol.h"
+#include "esphome.h"
+#include <cmath>
+#include <cstring>
+
+using esphome::esp_log_printf_;
+
+// Broadcast at least this often, even if nothing changed.
+static const uint32_t PEER_HEARTBEAT_INTERVAL = 60000; // in milliseconds
+
+// A report that isn't newer than the last one accepted from its sender is
+// only a duplicate or overtaken if it arrives within this long of it. Later
+// than that, the sender has restarted and is counting from 0 again, which
+// takes longer than this to boot and rejoin the network.
+static const uint32_t PEER_REORDER_WINDOW = 5000; // in milliseconds
+
+// A larger jump ahead than this is a restart too, rather than that many
+// reports lost.
+static const int16_t PEER_MAX_GAP = 256;
+
+void PeerProtocol::setWeight(float weight) {
+    weight_ = static_cast<uint16_t>(lroundf(weight * 100));
+}
+
+bool PeerProtocol::buildReport(
+    bool heat_cool,
+    float temperature_low,
+    float temperature_high,
+    float temperature_current,
+    uint32_t now_ms,
+    PeerPacket* packet) const {
+    if (std::isnan(temperature_current)) {
+        return false;
+    }
+
+    *packet = PeerPacket{};
+    packet->magic[0] = PeerPacket::MAGIC_0;
+    packet->magic[1] = PeerPacket::MAGIC_1;
+    packet->version = PeerPacket::VERSION;
+    packet->flags = heat_cool ? PeerPacket::HEAT_COOL : 0;
+    packet->group = group_;
+    packet->sender = sender_;
+    packet->sequence = sequence_;
+    packet->temperature_low = encodeTemperature(temperature_low);
+    packet->temperature_high = encodeTemperature(temperature_high);
+    packet->temperature_current = encodeTemperature(temperature_current);
+    packet->weight = weight_;
+
+    bool changed = packet->flags != last_sent_.flags ||
+        packet->temperature_low != last_sent_.temperature_low ||
+        packet->temperature_high != last_sent_.temperature_high ||
+        packet->temperature_current != last_sent_.temperature_current ||
+        packet->weight != last_sent_.weight;
+    return packets_sent_ == 0 || changed || now_ms - last_sent_at_ >= PEER_HEARTBEAT_INTERVAL;
+}
+
+void PeerProtocol::onSent(const PeerPacket& packet, uint32_t now_ms) {
+    last_sent_ = packet;
+    last_sent_at_ = now_ms;
+    sequence_ = packet.sequence + 1;
+    packets_sent_++;
+}
+
+bool PeerProtocol::receive(const uint8_t* data, size_t length, uint32_t now_ms) {
+    PeerPacket packet;
+    if (length != sizeof(packet)) {
+        return false;
+    }
+    memcpy(&packet, data, sizeof(packet));
+
+    if (packet.magic[0] != PeerPacket::MAGIC_0 ||
+        packet.magic[1] != PeerPacket::MAGIC_1 ||
+        packet.version != PeerPacket::VERSION) {
+        return false;
+    }
+
+    if (packet.group != group_ || packet.sender == sender_) {
+        // Another multisplit, or our own broadcast looped back.
+        return false;
+    }
+
+    if (!acceptSequence(packet.sender, packet.sequence, now_ms)) {
+        packets_out_of_order_++;
+        return false;
+    }
+
+    packets_received_++;
+    if (report_callback_) {
+        report_callback_(
+            packet.sender,
+            (packet.flags & PeerPacket::HEAT_COOL) != 0,
+            decodeTemperature(packet.temperature_low),
+            decodeTemperature(packet.temperature_high),
+            decodeTemperature(packet.temperature_current),
+            packet.weight / 100.0f);
+    }
+    return true;
+}
+
+bool PeerProtocol::acceptSequence(uint32_t sender, uint16_t sequence, uint32_t now_ms) {
+    // A multisplit has a handful of heads, a linear scan is enough.
+    uint8_t index = 0;
+    while (index < sender_count_ && senders_[index].id != sender) {
+        index++;
+    }
+
+    if (index == sender_count_) {
+        if (sender_count_ < MAX_SENDERS) {
+            sender_count_++;
+        } else {
+            index = 0;
+            for (uint8_t i = 1; i < sender_count_; i++) {
+                if (now_ms - senders_[i].heard_at > now_ms - senders_[index].heard_at) {
+                    index = i;
+                }
+            }
+        }
+        senders_[index] = Sender{sender, sequence, now_ms};
+        return true;
+    }
+
+    Sender& known = senders_[index];
+    // Distance from the last accepted report, modulo the sequence wrapping.
+    int16_t ahead = static_cast<int16_t>(sequence - known.sequence);
+    if (ahead <= 0 && now_ms - known.heard_at < PEER_REORDER_WINDOW) {
+        return false;
+    }
+    if (ahead > 0 && ahead <= PEER_MAX_GAP) {
+        packets_lost_ += ahead - 1;
+    } else {
+        ESP_LOGD("PeerProtocol", "Peer %08x restarted at sequence %u", sender, sequence);
+    }
+    known.sequence = sequence;
+    known.heard_at = now_ms;
+    return true;
+}
+
+int16_t PeerProtocol::encodeTemperature(float temperature) {
+    if (std::isnan(temperature)) {
+        return INT16_MIN;
+    }
+    return static_cast<int16_t>(lroundf(temperature * 100));
+}
+
+float PeerProtocol::decodeTemperature(int16_t temperature) {
+    if (temperature == INT16_MIN) {
+        return NAN;
+    }
+    return temperature / 100.0f;
+}
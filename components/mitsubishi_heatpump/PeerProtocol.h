@@ -0,0 +1,127 @@
+/**
+ * PeerProtocol.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef PEERPROTOCOL_H
+#define PEERPROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+// Dual point state of a head, as exchanged between heads on the same
+// multisplit.
+struct __attribute__((packed)) PeerPacket {
+    static const uint8_t MAGIC_0 = 'M';
+    static const uint8_t MAGIC_1 = 'H';
+    static const uint8_t VERSION = 2;
+
+    static const uint8_t HEAT_COOL = 1 << 0;
+
+    uint8_t magic[2];
+    uint8_t version;
+    uint8_t flags;
+    // Interned multisplit group name, heads only listen to their own group.
+    uint32_t group;
+    // Interned id of the sending head.
+    uint32_t sender;
+    // Counts the sender's reports since it booted. Receivers drop reports
+    // that are duplicates of, or older than, the last one they accepted.
+    uint16_t sequence;
+    // Temperatures in hundredths of a degree C.
+    int16_t temperature_low;
+    int16_t temperature_high;
+    int16_t temperature_current;
+    // zone_weight of the sending head in hundredths.
+    uint16_t weight;
+};
+
+// The transport independent half of the peer link: builds this head's
+// reports, and validates received ones before handing them to the report
+// callback. PeerLink carries the packets over WiFi multicast.
+//
+// UDP may deliver a datagram twice, or after a later one. Each sender's last
+// accepted sequence number is kept, and a report that isn't newer is dropped
+// so it can't roll a zone back to an older state. Gaps in the sequence are
+// counted as lost reports.
+class PeerProtocol {
+public:
+    typedef std::function<void(uint32_t sender,
+                               bool heat_cool,
+                               float temperature_low,
+                               float temperature_high,
+                               float temperature_current,
+                               float weight)> ReportCallback;
+
+    // Senders whose sequence is tracked, as many as ZoneTable holds zones.
+    // When full, the sender heard from least recently is forgotten.
+    static const uint8_t MAX_SENDERS = 64;
+
+    void setGroup(uint32_t group) { group_ = group; }
+
+    // Sets the interned id this head reports itself as.
+    void setSender(uint32_t sender) { sender_ = sender; }
+    uint32_t getSender() const { return sender_; }
+
+    // Sets the zone_weight this head reports.
+    void setWeight(float weight);
+
+    void setReportCallback(ReportCallback callback) { report_callback_ = callback; }
+
+    // Fills packet with this head's state if it changed since the last
+    // report sent, or if the heartbeat is due. Returns false if there is
+    // nothing to send. Call onSent() once the packet is on the wire.
+    bool buildReport(bool heat_cool,
+                     float temperature_low,
+                     float temperature_high,
+                     float temperature_current,
+                     uint32_t now_ms,
+                     PeerPacket* packet) const;
+    void onSent(const PeerPacket& packet, uint32_t now_ms);
+
+    // Validates a received datagram, and hands it to the report callback if
+    // it's a new report from another head in the group. Returns true if it
+    // was.
+    bool receive(const uint8_t* data, size_t length, uint32_t now_ms);
+
+    uint32_t getPacketsSent() const { return packets_sent_; }
+    uint32_t getPacketsReceived() const { return packets_received_; }
+    uint32_t getPacketsLost() const { return packets_lost_; }
+    // Duplicates, and reports that arrived after a newer one.
+    uint32_t getPacketsOutOfOrder() const { return packets_out_of_order_; }
+
+private:
+    struct Sender {
+        uint32_t id;
+        uint16_t sequence;
+        uint32_t heard_at;
+    };
+
+    static int16_t encodeTemperature(float temperature);
+    static float decodeTemperature(int16_t temperature);
+
+    // Returns false if the report should be dropped.
+    bool acceptSequence(uint32_t sender, uint16_t sequence, uint32_t now_ms);
+
+    uint32_t group_ = 0;
+    uint32_t sender_ = 0;
+    uint16_t weight_ = 100;
+    ReportCallback report_callback_;
+
+    PeerPacket last_sent_{};
+    uint32_t last_sent_at_ = 0;
+    uint16_t sequence_ = 0;
+
+    Sender senders_[MAX_SENDERS];
+    uint8_t sender_count_ = 0;
+
+    uint32_t packets_sent_ = 0;
+    uint32_t packets_received_ = 0;
+    uint32_t packets_lost_ = 0;
+    uint32_t packets_out_of_order_ = 0;
+};
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ * PreferenceCache.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "PreferenceCache.h"
+#include <stddef.h>
+
+using namespace esphome;
+
+// Offsets from the component's key used by earlier versions, which stored
+// each value in its own preference.
+static const uint32_t LEGACY_COOL_KEY_OFFSET = 1;
+static const uint32_t LEGACY_HEAT_KEY_OFFSET = 2;
+static const uint32_t LEGACY_MANAGED_MODE_KEY_OFFSET = 3;
+static const uint32_t RECORD_KEY_OFFSET = 5;
+
+void PreferenceCache::setup(uint32_t key) {
+    storage_ = global_preferences->make_preference<PreferenceRecord>(key + RECORD_KEY_OFFSET);
+
+    PreferenceRecord loaded;
+    if (storage_.load(&loaded)) {
+        if (loaded.version == PreferenceRecord::VERSION && loaded.crc == checksum(loaded)) {
+            record_ = loaded;
+            return;
+        }
+        ESP_LOGW("PreferenceCache", "Discarding invalid preference record (version %u)", loaded.version);
+    }
+
+    migrateLegacyPreferences(key);
+}
+
+void PreferenceCache::migrateLegacyPreferences(uint32_t key) {
+    ESPPreferenceObject cool_storage =
+        global_preferences->make_preference<uint8_t>(key + LEGACY_COOL_KEY_OFFSET);
+    ESPPreferenceObject heat_storage =
+        global_preferences->make_preference<uint8_t>(key + LEGACY_HEAT_KEY_OFFSET);
+    ESPPreferenceObject managed_mode_storage =
+        global_preferences->make_preference<bool>(key + LEGACY_MANAGED_MODE_KEY_OFFSET);
+
+    uint8_t steps = 0;
+    if (cool_storage.load(&steps)) {
+        record_.cool_steps = steps;
+        record_.flags |= PreferenceRecord::HAS_COOL_SETPOINT;
+    }
+    if (heat_storage.load(&steps)) {
+        record_.heat_steps = steps;
+        record_.flags |= PreferenceRecord::HAS_HEAT_SETPOINT;
+    }
+    bool managed_mode = false;
+    if (managed_mode_storage.load(&managed_mode)) {
+        record_.flags |= PreferenceRecord::HAS_MANAGED_MODE;
+        if (managed_mode) {
+            record_.flags |= PreferenceRecord::MANAGED_MODE;
+        }
+    }
+
+    if (record_.flags != 0) {
+        ESP_LOGD("PreferenceCache", "Migrated legacy preferences");
+        markDirty();
+    }
+}
+
+optional<float> PreferenceCache::getCoolSetpoint() const {
+    if (!(record_.flags & PreferenceRecord::HAS_COOL_SETPOINT)) {
+        return {};
+    }
+    return fromSteps(record_.cool_steps);
+}
+
+optional<float> PreferenceCache::getHeatSetpoint() const {
+    if (!(record_.flags & PreferenceRecord::HAS_HEAT_SETPOINT)) {
+        return {};
+    }
+    return fromSteps(record_.heat_steps);
+}
+
+optional<bool> PreferenceCache::getManagedMode() const {
+    if (!(record_.flags & PreferenceRecord::HAS_MANAGED_MODE)) {
+        return {};
+    }
+    return (record_.flags & PreferenceRecord::MANAGED_MODE) != 0;
+}
+
+bool PreferenceCache::getUnitState(PersistedUnitState* state) const {
+    if (!(record_.flags & PreferenceRecord::HAS_UNIT_STATE)) {
+        return false;
+    }
+    state->mode = static_cast<climate::ClimateMode>(record_.climate_mode);
+    state->fan_mode = static_cast<climate::ClimateFanMode>(record_.fan_mode);
+    state->swing_mode = static_cast<climate::ClimateSwingMode>(record_.swing_mode);
+    // Out of range vanes are restored as UNKNOWN rather than indexing past
+    // the option tables.
+    state->vane = record_.vane < static_cast<uint8_t>(HeatpumpVaneSetting::UNKNOWN)
+        ? static_cast<HeatpumpVaneSetting>(record_.vane)
+        : HeatpumpVaneSetting::UNKNOWN;
+    state->wide_vane = record_.wide_vane < static_cast<uint8_t>(HeatpumpWideVaneSetting::UNKNOWN)
+        ? static_cast<HeatpumpWideVaneSetting>(record_.wide_vane)
+        : HeatpumpWideVaneSetting::UNKNOWN;
+    return true;
+}
+
+HeatpumpMode PreferenceCache::getModeOverride() const {
+    return static_cast<HeatpumpMode>(record_.mode_override);
+}
+
+void PreferenceCache::setCoolSetpoint(float value) {
+    uint8_t steps = toSteps(value);
+    if ((record_.flags & PreferenceRecord::HAS_COOL_SETPOINT) && record_.cool_steps == steps) {
+        return;
+    }
+    record_.cool_steps = steps;
+    record_.flags |= PreferenceRecord::HAS_COOL_SETPOINT;
+    markDirty();
+}
+
+void PreferenceCache::setHeatSetpoint(float value) {
+    uint8_t steps = toSteps(value);
+    if ((record_.flags & PreferenceRecord::HAS_HEAT_SETPOINT) && record_.heat_steps == steps) {
+        return;
+    }
+    record_.heat_steps = steps;
+    record_.flags |= PreferenceRecord::HAS_HEAT_SETPOINT;
+    markDirty();
+}
+
+void PreferenceCache::setManagedMode(bool value) {
+    if (getManagedMode() == value) {
+        return;
+    }
+    record_.flags |= PreferenceRecord::HAS_MANAGED_MODE;
+    if (value) {
+        record_.flags |= PreferenceRecord::MANAGED_MODE;
+    } else {
+        record_.flags &= ~PreferenceRecord::MANAGED_MODE;
+    }
+    markDirty();
+}
+
+void PreferenceCache::setUnitState(const PersistedUnitState& state) {
+    uint8_t climate_mode = static_cast<uint8_t>(state.mode);
+    uint8_t fan_mode = static_cast<uint8_t>(state.fan_mode);
+    uint8_t swing_mode = static_cast<uint8_t>(state.swing_mode);
+    uint8_t vane = static_cast<uint8_t>(state.vane);
+    uint8_t wide_vane = static_cast<uint8_t>(state.wide_vane);
+    if ((record_.flags & PreferenceRecord::HAS_UNIT_STATE) &&
+        record_.climate_mode == climate_mode &&
+        record_.fan_mode == fan_mode &&
+        record_.swing_mode == swing_mode &&
+        record_.vane == vane &&
+        record_.wide_vane == wide_vane) {
+        return;
+    }
+    record_.climate_mode = climate_mode;
+    record_.fan_mode = fan_mode;
+    record_.swing_mode = swing_mode;
+    record_.vane = vane;
+    record_.wide_vane = wide_vane;
+    record_.flags |= PreferenceRecord::HAS_UNIT_STATE;
+    markDirty();
+}
+
+void PreferenceCache::setModeOverride(HeatpumpMode value) {
+    if (record_.mode_override == static_cast<uint8_t>(value)) {
+        return;
+    }
+    record_.mode_override = static_cast<uint8_t>(value);
+    markDirty();
+}
+
+void PreferenceCache::loop(uint32_t now_ms) {
+    if (dirty_ && now_ms - last_change_ >= quiet_period_) {
+        flush();
+    }
+}
+
+void PreferenceCache::flush() {
+    if (!dirty_) {
+        return;
+    }
+
+    dirty_ = false;
+    writes_++;
+    ESP_LOGD("PreferenceCache", "Writing preferences (%u writes, %u changes so far)", writes_, changes_);
+    record_.crc = checksum(record_);
+    storage_.save(&record_);
+}
+
+uint8_t PreferenceCache::toSteps(float value) const {
+    return (value - min_temperature_) / temperature_step_;
+}
+
+float PreferenceCache::fromSteps(uint8_t steps) const {
+    return min_temperature_ + (steps * temperature_step_);
+}
+
+// CRC-16/CCITT over every byte of the record except the crc itself.
+uint16_t PreferenceCache::checksum(const PreferenceRecord& record) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&record);
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < offsetof(PreferenceRecord, crc); i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+void PreferenceCache::markDirty() {
+    dirty_ = true;
+    last_change_ = millis();
+    changes_++;
+}
@@ -0,0 +1,118 @@
+/**
+ * PreferenceCache.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef PREFERENCECACHE_H
+#define PREFERENCECACHE_H
+
+#include "esphome.h"
+#include "esphome/core/preferences.h"
+#include "HeatpumpSettings.h"
+#include "ModeArbiter.h"
+
+// Record persisted by PreferenceCache. Setpoints are stored as the number of
+// temperature steps above the minimum temperature, and everything else as a
+// single byte, as the ESP only has a few bytes of rtc storage.
+struct __attribute__((packed)) PreferenceRecord {
+    static const uint8_t VERSION = 2;
+
+    static const uint8_t HAS_COOL_SETPOINT = 1 << 0;
+    static const uint8_t HAS_HEAT_SETPOINT = 1 << 1;
+    static const uint8_t HAS_MANAGED_MODE = 1 << 2;
+    static const uint8_t MANAGED_MODE = 1 << 3;
+    static const uint8_t HAS_UNIT_STATE = 1 << 4;
+
+    uint8_t version = VERSION;
+    uint8_t flags = 0;
+    uint8_t cool_steps = 0;
+    uint8_t heat_steps = 0;
+
+    // Last state reported by the unit, valid if HAS_UNIT_STATE is set.
+    uint8_t climate_mode = 0;
+    uint8_t fan_mode = 0;
+    uint8_t swing_mode = 0;
+    uint8_t vane = 0;
+    uint8_t wide_vane = 0;
+
+    // Last desired mode override, HeatpumpMode::UNKNOWN if there was none.
+    uint8_t mode_override = HeatpumpMode::UNKNOWN;
+
+    // CRC over all of the above, so a record written under a colliding key
+    // or by a different firmware is never restored.
+    uint16_t crc = 0;
+};
+
+// Unit state restored at boot, so the entity is usable before the first
+// read from the unit.
+struct PersistedUnitState {
+    esphome::climate::ClimateMode mode;
+    esphome::climate::ClimateFanMode fan_mode;
+    esphome::climate::ClimateSwingMode swing_mode;
+    HeatpumpVaneSetting vane;
+    HeatpumpWideVaneSetting wide_vane;
+};
+
+// Write-back cache for the setpoints, managed mode and last known unit state,
+// akin to how the IR remote remembers them.
+//
+// Setters only update the cached record. The record is written once no
+// further changes have been made for the quiet period, or when flush() is
+// called on shutdown, so a burst of changes from a single user interaction
+// costs one write instead of several.
+class PreferenceCache {
+public:
+    PreferenceCache(float min_temperature, float temperature_step, uint32_t quiet_period_ms) :
+        min_temperature_(min_temperature),
+        temperature_step_(temperature_step),
+        quiet_period_(quiet_period_ms) {};
+
+    // Loads the record stored under key. Values saved by earlier versions,
+    // as one preference per value, are migrated on first boot.
+    void setup(uint32_t key);
+
+    esphome::optional<float> getCoolSetpoint() const;
+    esphome::optional<float> getHeatSetpoint() const;
+    esphome::optional<bool> getManagedMode() const;
+    bool getUnitState(PersistedUnitState* state) const;
+    HeatpumpMode getModeOverride() const;
+
+    void setCoolSetpoint(float value);
+    void setHeatSetpoint(float value);
+    void setManagedMode(bool value);
+    void setUnitState(const PersistedUnitState& state);
+    void setModeOverride(HeatpumpMode value);
+
+    // Writes the record if it's dirty and the quiet period has elapsed.
+    void loop(uint32_t now_ms);
+
+    // Writes the record immediately if it's dirty.
+    void flush();
+
+    // Number of records written, and the number of changes that were merged
+    // into those writes.
+    uint32_t getWriteCount() const { return writes_; }
+    uint32_t getChangeCount() const { return changes_; }
+
+private:
+    uint8_t toSteps(float value) const;
+    float fromSteps(uint8_t steps) const;
+    void markDirty();
+    void migrateLegacyPreferences(uint32_t key);
+    static uint16_t checksum(const PreferenceRecord& record);
+
+    const float min_temperature_;
+    const float temperature_step_;
+    const uint32_t quiet_period_;
+
+    esphome::ESPPreferenceObject storage_;
+    PreferenceRecord record_;
+    bool dirty_ = false;
+    uint32_t last_change_ = 0;
+    uint32_t writes_ = 0;
+    uint32_t changes_ = 0;
+};
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * PublishGate.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "PublishGate.h"
+#include <cmath>
+
+static bool sameTemperature(float a, float b) {
+    if (std::isnan(a) || std::isnan(b)) {
+        return std::isnan(a) && std::isnan(b);
+    }
+    return a == b;
+}
+
+bool PublishGate::shouldPublish(const PublishedClimateState& state, uint32_t now_ms) {
+    if (!has_published_ || discreteStateChanged(state)) {
+        return true;
+    }
+
+    if (temperatureChanged(state.current_temperature)) {
+        if (now_ms - last_publish_time_ >= min_publish_interval_) {
+            return true;
+        }
+        pending_ = true;
+    }
+
+    suppressed_++;
+    return false;
+}
+
+void PublishGate::onPublished(const PublishedClimateState& state, uint32_t now_ms) {
+    has_published_ = true;
+    pending_ = false;
+    last_published_ = state;
+    last_publish_time_ = now_ms;
+    published_++;
+}
+
+bool PublishGate::hasPendingPublish(uint32_t now_ms) const {
+    return pending_ && now_ms - last_publish_time_ >= min_publish_interval_;
+}
+
+bool PublishGate::discreteStateChanged(const PublishedClimateState& state) const {
+    return state.mode != last_published_.mode ||
+        state.action != last_published_.action ||
+        state.fan_mode != last_published_.fan_mode ||
+        state.swing_mode != last_published_.swing_mode ||
+        !sameTemperature(state.target_temperature_low, last_published_.target_temperature_low) ||
+        !sameTemperature(state.target_temperature_high, last_published_.target_temperature_high);
+}
+
+bool PublishGate::temperatureChanged(float current_temperature) const {
+    float previous = last_published_.current_temperature;
+    if (std::isnan(current_temperature) || std::isnan(previous)) {
+        return !sameTemperature(current_temperature, previous);
+    }
+    return fabs(current_temperature - previous) >= temperature_threshold_ &&
+        current_temperature != previous;
+}
@@ -0,0 +1,68 @@
+/**
+ * PublishGate.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef PUBLISHGATE_H
+#define PUBLISHGATE_H
+
+#include "esphome.h"
+
+// The parts of the climate state that are sent to Home Assistant.
+struct PublishedClimateState {
+    esphome::climate::ClimateMode mode = esphome::climate::CLIMATE_MODE_OFF;
+    esphome::climate::ClimateAction action = esphome::climate::CLIMATE_ACTION_OFF;
+    esphome::optional<esphome::climate::ClimateFanMode> fan_mode;
+    esphome::climate::ClimateSwingMode swing_mode = esphome::climate::CLIMATE_SWING_OFF;
+    float current_temperature = NAN;
+    float target_temperature_low = NAN;
+    float target_temperature_high = NAN;
+};
+
+// Decides whether a climate state is worth publishing, by comparing it to the
+// last state that was published.
+//
+// Changes to the mode, action, fan, swing or setpoints are always published.
+// Changes to the current temperature are only published once they exceed the
+// temperature threshold, and no more often than the minimum publish interval.
+// A change held back by the interval is remembered and flushed later through
+// hasPendingPublish().
+class PublishGate {
+public:
+    void setTemperatureThreshold(float threshold) { temperature_threshold_ = threshold; }
+    void setMinPublishInterval(uint32_t interval_ms) { min_publish_interval_ = interval_ms; }
+
+    // Returns true if state should be published now. Counts the publish as
+    // suppressed otherwise.
+    bool shouldPublish(const PublishedClimateState& state, uint32_t now_ms);
+
+    // Records that state was published.
+    void onPublished(const PublishedClimateState& state, uint32_t now_ms);
+
+    // Returns true if a change was held back by the minimum publish interval
+    // and the interval has now elapsed.
+    bool hasPendingPublish(uint32_t now_ms) const;
+
+    uint32_t getPublishCount() const { return published_; }
+    uint32_t getSuppressedCount() const { return suppressed_; }
+
+private:
+    // Returns true if anything other than the current temperature changed.
+    bool discreteStateChanged(const PublishedClimateState& state) const;
+
+    bool temperatureChanged(float current_temperature) const;
+
+    float temperature_threshold_ = 0;
+    uint32_t min_publish_interval_ = 0;
+
+    bool has_published_ = false;
+    bool pending_ = false;
+    PublishedClimateState last_published_;
+    uint32_t last_publish_time_ = 0;
+    uint32_t published_ = 0;
+    uint32_t suppressed_ = 0;
+};
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * RemoteTemperatureFilter.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "RemoteTemperatureFilter.h"
+#include <algorithm>
+#include <cmath>
+
+// A new quantized value is only written once the conditioned value is this
+// many steps away from the last written one, so readings hovering on a step
+// boundary don't flip between two values.
+static const float QUANTIZATION_HYSTERESIS = 0.6;
+
+void RemoteTemperatureFilter::setConfig(const RemoteTemperatureFilterConfig& config) {
+    config_ = config;
+    if (config_.window_size < 1) {
+        config_.window_size = 1;
+    } else if (config_.window_size > MAX_WINDOW_SIZE) {
+        config_.window_size = MAX_WINDOW_SIZE;
+    }
+    reset();
+}
+
+RemoteTemperatureFilter::Result RemoteTemperatureFilter::process(float reading, float* value) {
+    readings_++;
+
+    if (has_value_ && config_.outlier_threshold > 0 &&
+        fabsf(reading - smoothed_) > config_.outlier_threshold) {
+        if (++consecutive_outliers_ < MAX_CONSECUTIVE_OUTLIERS) {
+            rejected_++;
+            return Result::REJECTED;
+        }
+        // The readings agree with each other, not with the history.
+        reset();
+    }
+    consecutive_outliers_ = 0;
+
+    bool first = !has_value_;
+    smoothed_ = smooth(reading);
+    has_value_ = true;
+
+    float conditioned = quantize(smoothed_);
+    if (!first && written_ == conditioned) {
+        writes_saved_++;
+        return Result::UNCHANGED;
+    }
+    if (!first && config_.quantization > 0 &&
+        fabsf(smoothed_ - written_) < config_.quantization * QUANTIZATION_HYSTERESIS) {
+        writes_saved_++;
+        return Result::UNCHANGED;
+    }
+
+    written_ = conditioned;
+    writes_++;
+    *value = conditioned;
+    return Result::WRITE;
+}
+
+void RemoteTemperatureFilter::reset() {
+    has_value_ = false;
+    consecutive_outliers_ = 0;
+    window_next_ = 0;
+    window_count_ = 0;
+}
+
+float RemoteTemperatureFilter::smooth(float reading) {
+    switch (config_.smoothing) {
+        case RemoteTemperatureSmoothing::MEDIAN:
+            window_[window_next_] = reading;
+            window_next_ = (window_next_ + 1) % config_.window_size;
+            if (window_count_ < config_.window_size) {
+                window_count_++;
+            }
+            return median();
+        case RemoteTemperatureSmoothing::EMA:
+            if (!has_value_) {
+                return reading;
+            }
+            return smoothed_ + config_.alpha * (reading - smoothed_);
+        default:
+            return reading;
+    }
+}
+
+float RemoteTemperatureFilter::median() const {
+    float sorted[MAX_WINDOW_SIZE];
+    std::copy(window_, window_ + window_count_, sorted);
+    std::sort(sorted, sorted + window_count_);
+    if (window_count_ % 2 == 1) {
+        return sorted[window_count_ / 2];
+    }
+    return (sorted[window_count_ / 2 - 1] + sorted[window_count_ / 2]) / 2;
+}
+
+float RemoteTemperatureFilter::quantize(float value) const {
+    if (config_.quantization <= 0) {
+        return value;
+    }
+    return roundf(value / config_.quantization) * config_.quantization;
+}
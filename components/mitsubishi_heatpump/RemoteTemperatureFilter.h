@@ -0,0 +1,90 @@
+/**
+ * RemoteTemperatureFilter.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef REMOTETEMPERATUREFILTER_H
+#define REMOTETEMPERATUREFILTER_H
+
+#include <stdint.h>
+
+enum class RemoteTemperatureSmoothing : uint8_t {
+    NONE,
+    MEDIAN,
+    EMA
+};
+
+struct RemoteTemperatureFilterConfig {
+    RemoteTemperatureSmoothing smoothing = RemoteTemperatureSmoothing::NONE;
+    // Number of readings the median is taken over.
+    uint8_t window_size = 5;
+    // Weight of each new reading in the exponential moving average.
+    float alpha = 0.3;
+    // Readings further than this from the smoothed value are dropped, in
+    // degrees C. 0 disables outlier rejection.
+    float outlier_threshold = 0;
+    // Resolution written to the unit, in degrees C. 0 disables quantization.
+    float quantization = 0.5;
+};
+
+// Conditions readings passed to set_remote_temperature() before they're
+// written to the unit, so chatty sensors don't cause a CN105 write for every
+// reading that the unit can't tell apart.
+class RemoteTemperatureFilter {
+public:
+    static const uint8_t MAX_WINDOW_SIZE = 9;
+
+    // Readings in a row rejected as outliers before they're accepted as a
+    // real step change, e.g. the sensor being moved.
+    static const uint8_t MAX_CONSECUTIVE_OUTLIERS = 3;
+
+    enum Result {
+        // The reading was dropped as an outlier.
+        REJECTED,
+        // The reading was accepted, but the conditioned value is unchanged.
+        UNCHANGED,
+        // The conditioned value changed and should be written to the unit.
+        WRITE
+    };
+
+    void setConfig(const RemoteTemperatureFilterConfig& config);
+    const RemoteTemperatureFilterConfig& getConfig() const { return config_; }
+
+    // Feeds a reading through the pipeline. On WRITE, value holds the
+    // conditioned temperature to send to the unit.
+    Result process(float reading, float* value);
+
+    // Forgets all history, e.g. when switching back to the internal sensor.
+    void reset();
+
+    uint32_t getReadings() const { return readings_; }
+    uint32_t getRejected() const { return rejected_; }
+    uint32_t getWrites() const { return writes_; }
+    // Accepted readings that didn't need a write.
+    uint32_t getWritesSaved() const { return writes_saved_; }
+
+private:
+    float smooth(float reading);
+    float median() const;
+    float quantize(float value) const;
+
+    RemoteTemperatureFilterConfig config_;
+
+    bool has_value_ = false;
+    float smoothed_ = 0;
+    float written_ = 0;
+    uint8_t consecutive_outliers_ = 0;
+
+    float window_[MAX_WINDOW_SIZE];
+    uint8_t window_next_ = 0;
+    uint8_t window_count_ = 0;
+
+    uint32_t readings_ = 0;
+    uint32_t rejected_ = 0;
+    uint32_t writes_ = 0;
+    uint32_t writes_saved_ = 0;
+};
+
+#endif
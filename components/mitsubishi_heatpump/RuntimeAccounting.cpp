@@ -0,0 +1,134 @@
+/**
+ * RuntimeAccounting.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "RuntimeAccounting.h"
+
+using namespace esphome;
+
+// Offset from the component's key, after the ones used by PreferenceCache.
+static const uint32_t RUNTIME_KEY_OFFSET = 6;
+
+static const float MS_PER_HOUR = 3600000.0f;
+
+void RuntimeAccounting::setup(uint32_t key) {
+    storage_ = global_preferences->make_preference<RuntimeCheckpoint>(key + RUNTIME_KEY_OFFSET);
+
+    RuntimeCheckpoint loaded;
+    if (!storage_.load(&loaded) || loaded.version != RuntimeCheckpoint::VERSION) {
+        return;
+    }
+
+    compressor_ms_ = loaded.compressor_seconds * 1000ULL;
+    compressor_starts_ = loaded.compressor_starts;
+    frequency_ms_ = loaded.frequency_seconds * 1000ULL;
+    for (uint8_t i = 0; i < RuntimeCheckpoint::MODE_COUNT; i++) {
+        mode_ms_[i] = loaded.mode_seconds[i] * 1000ULL;
+    }
+    ESP_LOGD("RuntimeAccounting", "Restored runtime: compressor %.1f h, %u starts",
+        getCounter(RUNTIME_COMPRESSOR), compressor_starts_);
+}
+
+void RuntimeAccounting::onStatus(
+    uint32_t now_ms,
+    climate::ClimateMode mode,
+    bool operating,
+    int compressor_frequency) {
+    accrue(now_ms);
+
+    if (operating && !operating_ && has_sample_) {
+        compressor_starts_++;
+        dirty_ = true;
+    }
+    has_sample_ = true;
+    last_sample_at_ = now_ms;
+    mode_index_ = modeIndex(mode);
+    operating_ = operating;
+    frequency_ = compressor_frequency > 0 ? compressor_frequency : 0;
+}
+
+void RuntimeAccounting::onLinkLost() {
+    has_sample_ = false;
+    operating_ = false;
+}
+
+void RuntimeAccounting::accrue(uint32_t now_ms) {
+    if (!has_sample_) {
+        return;
+    }
+
+    uint32_t elapsed = now_ms - last_sample_at_;
+    if (elapsed == 0 || elapsed > MAX_SAMPLE_GAP) {
+        return;
+    }
+
+    // Only what actually advanced needs a checkpoint, so a unit sitting idle
+    // in OFF doesn't wear the flash.
+    if (operating_) {
+        compressor_ms_ += elapsed;
+        frequency_ms_ += static_cast<uint64_t>(frequency_) * elapsed;
+        dirty_ = true;
+    }
+    if (mode_index_ >= 0) {
+        mode_ms_[mode_index_] += elapsed;
+        dirty_ = true;
+    }
+}
+
+void RuntimeAccounting::loop(uint32_t now_ms) {
+    if (dirty_ && now_ms - last_checkpoint_at_ >= CHECKPOINT_INTERVAL) {
+        last_checkpoint_at_ = now_ms;
+        flush();
+    }
+}
+
+void RuntimeAccounting::flush() {
+    if (!dirty_) {
+        return;
+    }
+
+    RuntimeCheckpoint checkpoint;
+    checkpoint.compressor_seconds = compressor_ms_ / 1000;
+    checkpoint.compressor_starts = compressor_starts_;
+    checkpoint.frequency_seconds = frequency_ms_ / 1000;
+    for (uint8_t i = 0; i < RuntimeCheckpoint::MODE_COUNT; i++) {
+        checkpoint.mode_seconds[i] = mode_ms_[i] / 1000;
+    }
+
+    dirty_ = false;
+    checkpoints_++;
+    storage_.save(&checkpoint);
+}
+
+float RuntimeAccounting::getCounter(RuntimeCounter counter) const {
+    switch (counter) {
+        case RUNTIME_COMPRESSOR:
+            return compressor_ms_ / MS_PER_HOUR;
+        case RUNTIME_COMPRESSOR_STARTS:
+            return compressor_starts_;
+        case RUNTIME_FREQUENCY_HOURS:
+            return frequency_ms_ / MS_PER_HOUR;
+        default:
+            return mode_ms_[counter - RUNTIME_HEAT] / MS_PER_HOUR;
+    }
+}
+
+int8_t RuntimeAccounting::modeIndex(climate::ClimateMode mode) {
+    switch (mode) {
+        case climate::CLIMATE_MODE_HEAT:
+            return RUNTIME_HEAT - RUNTIME_HEAT;
+        case climate::CLIMATE_MODE_COOL:
+            return RUNTIME_COOL - RUNTIME_HEAT;
+        case climate::CLIMATE_MODE_HEAT_COOL:
+            return RUNTIME_HEAT_COOL - RUNTIME_HEAT;
+        case climate::CLIMATE_MODE_DRY:
+            return RUNTIME_DRY - RUNTIME_HEAT;
+        case climate::CLIMATE_MODE_FAN_ONLY:
+            return RUNTIME_FAN_ONLY - RUNTIME_HEAT;
+        default:
+            return -1;
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * RuntimeAccounting.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef RUNTIMEACCOUNTING_H
+#define RUNTIMEACCOUNTING_H
+
+#include "esphome.h"
+#include "esphome/core/preferences.h"
+
+// Totals kept by RuntimeAccounting.
+enum RuntimeCounter {
+    // Hours the compressor has been running.
+    RUNTIME_COMPRESSOR,
+    // Number of times the compressor started.
+    RUNTIME_COMPRESSOR_STARTS,
+    // Compressor frequency integrated over time, in Hz hours. A rough proxy
+    // for the energy used, comparable between heads of the same model.
+    RUNTIME_FREQUENCY_HOURS,
+    // Hours spent in each climate mode, whether or not the compressor ran.
+    RUNTIME_HEAT,
+    RUNTIME_COOL,
+    RUNTIME_HEAT_COOL,
+    RUNTIME_DRY,
+    RUNTIME_FAN_ONLY,
+    RUNTIME_COUNTER_COUNT
+};
+
+// Checkpoint of the totals, persisted so they survive reboots. Times are in
+// seconds.
+struct __attribute__((packed)) RuntimeCheckpoint {
+    static const uint8_t VERSION = 1;
+    static const uint8_t MODE_COUNT = RUNTIME_COUNTER_COUNT - RUNTIME_HEAT;
+
+    uint8_t version = VERSION;
+    uint32_t compressor_seconds = 0;
+    uint32_t compressor_starts = 0;
+    uint64_t frequency_seconds = 0; // in Hz seconds
+    uint32_t mode_seconds[MODE_COUNT] = {};
+};
+
+// Integrates compressor runtime, starts, time per mode and compressor
+// frequency from the unit's status.
+//
+// Each status credits the time since the previous one to the previously
+// reported state, so the work per packet is constant. Time while the link is
+// down isn't credited to anything.
+class RuntimeAccounting {
+public:
+    // Interval between checkpoints, as long as something changed.
+    static const uint32_t CHECKPOINT_INTERVAL = 900000; // in milliseconds
+
+    // Longest gap between samples that is credited. Anything longer means
+    // samples were missed, and is dropped rather than guessed.
+    static const uint32_t MAX_SAMPLE_GAP = 300000; // in milliseconds
+
+    // Restores the checkpoint stored under key.
+    void setup(uint32_t key);
+
+    // Called with every status reported by the unit, and periodically with
+    // the latest one, so a steady state is credited even when the library
+    // only reports changes.
+    void onStatus(
+        uint32_t now_ms,
+        esphome::climate::ClimateMode mode,
+        bool operating,
+        int compressor_frequency);
+
+    // Called when the link to the unit is lost.
+    void onLinkLost();
+
+    // Writes a checkpoint if one is due, or immediately on flush().
+    void loop(uint32_t now_ms);
+    void flush();
+
+    // Hours, or a count for RUNTIME_COMPRESSOR_STARTS.
+    float getCounter(RuntimeCounter counter) const;
+
+    uint32_t getCheckpoints() const { return checkpoints_; }
+
+private:
+    void accrue(uint32_t now_ms);
+    static int8_t modeIndex(esphome::climate::ClimateMode mode);
+
+    esphome::ESPPreferenceObject storage_;
+
+    // Totals restored from the checkpoint plus everything since, in
+    // milliseconds and Hz milliseconds.
+    uint64_t compressor_ms_ = 0;
+    uint32_t compressor_starts_ = 0;
+    uint64_t frequency_ms_ = 0;
+    uint64_t mode_ms_[RuntimeCheckpoint::MODE_COUNT] = {};
+
+    // State credited until the next sample.
+    bool has_sample_ = false;
+    uint32_t last_sample_at_ = 0;
+    int8_t mode_index_ = -1;
+    bool operating_ = false;
+    uint16_t frequency_ = 0;
+
+    bool dirty_ = false;
+    uint32_t last_checkpoint_at_ = 0;
+    uint32_t checkpoints_ = 0;
+};
+
+#endif
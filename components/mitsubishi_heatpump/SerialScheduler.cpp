@@ -0,0 +1,75 @@
+/**
+ * SerialScheduler.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "SerialScheduler.h"
+#include "esphome.h"
+
+using esphome::esp_log_printf_;
+
+SerialScheduler& SerialScheduler::shared() {
+    static SerialScheduler scheduler;
+    return scheduler;
+}
+
+uint8_t SerialScheduler::registerLink() {
+    if (link_count_ >= MAX_LINKS) {
+        ESP_LOGW("SerialScheduler", "More than %u heatpumps, not scheduling the extra ones", MAX_LINKS);
+        return NO_LINK;
+    }
+    return link_count_++;
+}
+
+void SerialScheduler::request(uint8_t link, uint32_t now_ms) {
+    if (link == NO_LINK || links_[link].waiting) {
+        return;
+    }
+    links_[link].waiting = true;
+    links_[link].waiting_since = now_ms;
+}
+
+bool SerialScheduler::acquire(uint8_t link, uint32_t now_ms) {
+    if (link == NO_LINK) {
+        return true;
+    }
+
+    Link& candidate = links_[link];
+    if (!candidate.waiting) {
+        return false;
+    }
+
+    if (last_granted_ != link && last_granted_ != NO_LINK &&
+        now_ms - last_release_at_ < MIN_GAP_MS) {
+        return false;
+    }
+
+    // Longest waiting link first, ties go round robin after the last turn.
+    uint32_t waited = now_ms - candidate.waiting_since;
+    for (uint8_t other = 0; other < link_count_; other++) {
+        if (other == link || !links_[other].waiting) {
+            continue;
+        }
+        uint32_t other_waited = now_ms - links_[other].waiting_since;
+        if (other_waited > waited ||
+            (other_waited == waited && roundRobinRank(other) < roundRobinRank(link))) {
+            return false;
+        }
+    }
+
+    candidate.waiting = false;
+    candidate.wait_ms.record(waited);
+    last_granted_ = link;
+    return true;
+}
+
+void SerialScheduler::release(uint32_t now_ms) {
+    last_release_at_ = now_ms;
+}
+
+uint8_t SerialScheduler::roundRobinRank(uint8_t link) const {
+    uint8_t first = last_granted_ == NO_LINK ? 0 : (last_granted_ + 1) % link_count_;
+    return (link + link_count_ - first) % link_count_;
+}
@@ -0,0 +1,70 @@
+/**
+ * SerialScheduler.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef SERIALSCHEDULER_H
+#define SERIALSCHEDULER_H
+
+#include "LinkStatistics.h"
+#include <stdint.h>
+
+// Shares the main loop between the CN105 links of every heatpump driven by
+// this node.
+//
+// Each link has its own UART, but the HeatPump library reads and writes
+// packets synchronously, so several units syncing in the same loop
+// iteration add up. Links request a turn when they have serial work to do,
+// and turns are granted to the longest waiting link, one per
+// MIN_GAP_MS, so per unit latency stays bounded as units are added.
+class SerialScheduler {
+public:
+    // Every UART on an ESP32.
+    static const uint8_t MAX_LINKS = 3;
+    static const uint8_t NO_LINK = 0xFF;
+
+    // Time left for the rest of the main loop between two different links'
+    // turns.
+    static const uint32_t MIN_GAP_MS = 10;
+
+    // The scheduler shared by every heatpump on this node.
+    static SerialScheduler& shared();
+
+    // Returns the id for a new link, or NO_LINK if every slot is taken, in
+    // which case the link is never held back.
+    uint8_t registerLink();
+
+    // Marks the link as having serial work to do. Requesting again while
+    // already waiting keeps the original place in line.
+    void request(uint8_t link, uint32_t now_ms);
+
+    // Returns true if the link requested a turn and may use the serial port
+    // now. Must be followed by release().
+    bool acquire(uint8_t link, uint32_t now_ms);
+
+    void release(uint32_t now_ms);
+
+    uint8_t getLinkCount() const { return link_count_; }
+
+    // Time from request() until the turn was granted, in milliseconds.
+    const RunningStats& getWaitTime(uint8_t link) const { return links_[link].wait_ms; }
+
+private:
+    // Position of the link in line after the last granted one.
+    uint8_t roundRobinRank(uint8_t link) const;
+
+    struct Link {
+        bool waiting = false;
+        uint32_t waiting_since = 0;
+        RunningStats wait_ms;
+    };
+
+    Link links_[MAX_LINKS];
+    uint8_t link_count_ = 0;
+    uint8_t last_granted_ = NO_LINK;
+    uint32_t last_release_at_ = 0;
+};
+
+#endif
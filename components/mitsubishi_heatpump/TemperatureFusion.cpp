@@ -0,0 +1,173 @@
+/**
+ * TemperatureFusion.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "TemperatureFusion.h"
+#include "esphome.h"
+#include <cmath>
+
+using esphome::esp_log_printf_;
+
+const float TemperatureFusion::OUTLIER_THRESHOLD = 2.0;
+
+bool TemperatureFusion::configure(uint32_t id, float weight, uint32_t max_age_ms) {
+    int index = findOrAdd(id);
+    if (index < 0) {
+        return false;
+    }
+    sensors_[index].weight = weight;
+    sensors_[index].max_age = max_age_ms;
+    return true;
+}
+
+bool TemperatureFusion::report(uint32_t id, float value, uint32_t now_ms) {
+    int index = findOrAdd(id);
+    if (index < 0) {
+        ESP_LOGW("TemperatureFusion", "Too many remote sensors, ignoring sensor %08x", id);
+        return false;
+    }
+
+    FusedSensor& sensor = sensors_[index];
+    sensor.value = value;
+    sensor.updated_at = now_ms;
+    sensor.active = true;
+    return true;
+}
+
+void TemperatureFusion::drop(uint32_t id) {
+    int index = find(id);
+    if (index >= 0) {
+        sensors_[index].active = false;
+    }
+}
+
+void TemperatureFusion::reset() {
+    for (uint8_t i = 0; i < size_; i++) {
+        sensors_[i].active = false;
+    }
+}
+
+uint8_t TemperatureFusion::expire(uint32_t now_ms) {
+    uint8_t expired = 0;
+    for (uint8_t i = 0; i < size_; i++) {
+        FusedSensor& sensor = sensors_[i];
+        if (sensor.active && sensor.max_age > 0 && now_ms - sensor.updated_at >= sensor.max_age) {
+            ESP_LOGW("TemperatureFusion", "Remote sensor %08x hasn't reported in %u ms, dropping it",
+                sensor.id, now_ms - sensor.updated_at);
+            sensor.active = false;
+            expired++;
+        }
+    }
+    sensors_expired_ += expired;
+    return expired;
+}
+
+bool TemperatureFusion::nextExpiry(uint32_t* due_ms) const {
+    bool found = false;
+    for (uint8_t i = 0; i < size_; i++) {
+        const FusedSensor& sensor = sensors_[i];
+        if (!sensor.active || sensor.max_age == 0) {
+            continue;
+        }
+        uint32_t due = sensor.updated_at + sensor.max_age;
+        if (!found || static_cast<int32_t>(due - *due_ms) < 0) {
+            *due_ms = due;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool TemperatureFusion::fuse(float* value) {
+    // Active readings in ascending order, insertion sorted as they're
+    // collected.
+    float readings[MAX_SENSORS];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < size_; i++) {
+        if (!sensors_[i].active) {
+            continue;
+        }
+        float value = sensors_[i].value;
+        uint8_t j = count++;
+        for (; j > 0 && readings[j - 1] > value; j--) {
+            readings[j] = readings[j - 1];
+        }
+        readings[j] = value;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    float median = count % 2 ? readings[count / 2]
+                             : (readings[count / 2 - 1] + readings[count / 2]) / 2;
+    // With two sensors there's no telling which one is wrong.
+    bool exclude_outliers = count >= 3;
+
+    float weighted_total = 0;
+    float total_weight = 0;
+    for (uint8_t i = 0; i < size_; i++) {
+        FusedSensor& sensor = sensors_[i];
+        if (!sensor.active) {
+            sensor.excluded = false;
+            continue;
+        }
+        bool excluded = exclude_outliers && fabsf(sensor.value - median) > OUTLIER_THRESHOLD;
+        if (excluded && !sensor.excluded) {
+            outliers_excluded_++;
+        }
+        sensor.excluded = excluded;
+        if (excluded) {
+            continue;
+        }
+        weighted_total += sensor.weight * sensor.value;
+        total_weight += sensor.weight;
+    }
+
+    if (total_weight <= 0) {
+        // Every remaining sensor has a weight of 0, fall back to the median.
+        *value = median;
+        return true;
+    }
+    *value = weighted_total / total_weight;
+    return true;
+}
+
+uint8_t TemperatureFusion::getActiveCount() const {
+    uint8_t active = 0;
+    for (uint8_t i = 0; i < size_; i++) {
+        if (sensors_[i].active) {
+            active++;
+        }
+    }
+    return active;
+}
+
+int TemperatureFusion::find(uint32_t id) const {
+    for (uint8_t i = 0; i < size_; i++) {
+        if (sensors_[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int TemperatureFusion::findOrAdd(uint32_t id) {
+    int index = find(id);
+    if (index >= 0 || size_ == MAX_SENSORS) {
+        return index;
+    }
+
+    index = size_++;
+    FusedSensor& sensor = sensors_[index];
+    sensor.id = id;
+    sensor.weight = 1;
+    sensor.max_age = DEFAULT_MAX_AGE;
+    sensor.value = 0;
+    sensor.updated_at = 0;
+    sensor.active = false;
+    sensor.excluded = false;
+    return index;
+}
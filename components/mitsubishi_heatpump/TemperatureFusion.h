@@ -0,0 +1,86 @@
+/**
+ * TemperatureFusion.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef TEMPERATUREFUSION_H
+#define TEMPERATUREFUSION_H
+
+#include <stdint.h>
+
+// Latest reading of one of the remote sensors in a room.
+struct FusedSensor {
+    uint32_t id;
+    // Relative trust in this sensor when readings are combined.
+    float weight;
+    // The sensor is dropped if it doesn't report for longer than this, in
+    // milliseconds. 0 keeps its last reading until it's removed.
+    uint32_t max_age;
+    float value;
+    uint32_t updated_at;
+    bool active;
+    // Whether the last fuse() left this sensor out as an outlier.
+    bool excluded;
+};
+
+// Combines readings from several remote sensors in one room into a single
+// temperature for the unit.
+//
+// Each sensor keeps its latest reading, so a report only updates its own
+// entry and the fused value is recomputed over the few active sensors. With
+// three or more active sensors, readings further than OUTLIER_THRESHOLD from
+// their median are left out, so one faulty sensor can't drag the room
+// temperature. The rest are averaged by weight. A sensor that goes quiet is
+// dropped on its own, the others keep the remote temperature alive.
+class TemperatureFusion {
+public:
+    static const uint8_t MAX_SENSORS = 4;
+    static const uint32_t DEFAULT_MAX_AGE = 0; // in milliseconds
+    static const float OUTLIER_THRESHOLD; // in degrees C
+
+    // Sets the weight and maximum age of a sensor. Sensors that report
+    // without being configured get a weight of 1 and DEFAULT_MAX_AGE.
+    // Returns false if every slot is taken.
+    bool configure(uint32_t id, float weight, uint32_t max_age_ms);
+
+    // Records a reading. Returns false if the sensor is unknown and every
+    // slot is taken.
+    bool report(uint32_t id, float value, uint32_t now_ms);
+
+    // Drops the sensor's reading, e.g. when it reports an invalid value.
+    void drop(uint32_t id);
+
+    // Drops every reading.
+    void reset();
+
+    // Drops readings older than their sensor's maximum age. Returns the
+    // number of sensors dropped.
+    uint8_t expire(uint32_t now_ms);
+
+    // Returns false if no reading can go stale, otherwise when the next one
+    // does.
+    bool nextExpiry(uint32_t* due_ms) const;
+
+    // Returns false if no sensor has a reading, otherwise the fused value.
+    bool fuse(float* value);
+
+    uint8_t getActiveCount() const;
+    // Number of times a sensor started being left out as an outlier. A
+    // sensor that stays off is only counted once.
+    uint32_t getOutliersExcluded() const { return outliers_excluded_; }
+    uint32_t getSensorsExpired() const { return sensors_expired_; }
+
+private:
+    int find(uint32_t id) const;
+    int findOrAdd(uint32_t id);
+
+    FusedSensor sensors_[MAX_SENSORS];
+    uint8_t size_ = 0;
+
+    uint32_t outliers_excluded_ = 0;
+    uint32_t sensors_expired_ = 0;
+};
+
+#endif
@@ -15,17 +15,14 @@
 using esphome::esp_log_printf_;
 
 twoPointHeatPumpSettings TwoPointHeatPump::getSettings() {
-    heatpumpSettings settings = HeatPump::getSettings();
+    HeatpumpSettingsModel settings = readReconciledSettings();
 
     twoPointHeatPumpSettings result;
-    result.power = managed_mode_ ? "ON" : settings.power;
-    result.mode = managed_mode_ ? "DUAL_POINT" : settings.mode;
-    result.temperature = settings.temperature;
-    result.fan = settings.fan;
-    result.vane = settings.vane;
-    result.wideVane = settings.wideVane;
-    result.iSee = settings.iSee;
-    result.connected = settings.connected;
+    static_cast<HeatpumpSettingsModel&>(result) = settings;
+    if (managed_mode_ && settings.isValid()) {
+        result.power = HeatpumpPowerSetting::ON;
+        result.mode = HeatpumpModeSetting::DUAL_POINT;
+    }
 
     result.temperature_low = temperature_low_;
     result.temperature_high = temperature_high_;
@@ -35,21 +32,21 @@ twoPointHeatPumpSettings TwoPointHeatPump::getSettings() {
 
 boolean TwoPointHeatPump::readTemperatureSetpointsFromHeatPump() { 
     boolean updated = false;
-    heatpumpSettings settings = HeatPump::getSettings();
-    if (settings.power == NULL) {
+    HeatpumpSettingsModel settings = readReconciledSettings();
+    if (!settings.isValid()) {
         // Heatpump not fully initialized yet.
         return updated;
     }
 
-    if (strcmp(settings.power, "ON") == 0) {
-        if (strcmp(settings.mode, "HEAT") == 0 && 
+    if (settings.power == HeatpumpPowerSetting::ON) {
+        if (settings.mode == HeatpumpModeSetting::HEAT && 
             settings.temperature != temperature_high_ &&
             settings.temperature != temperature_low_) {
             ESP_LOGD("TwoPointHeatPump", "Currently set to HEAT, extracting low temperature from unit. Temperature Low/High/Current: %.2f/%.2f/%.2f", temperature_low_, temperature_high_, settings.temperature);
             temperature_low_ = settings.temperature;
             updated = true;
         }
-        else if (strcmp(settings.mode, "COOL") == 0 && 
+        else if (settings.mode == HeatpumpModeSetting::COOL && 
             settings.temperature != temperature_low_ &&
             settings.temperature != temperature_high_) {
             ESP_LOGD("TwoPointHeatPump", "Currently set to COOL, extracting high temperature from unit. Temperature Low/High/Current: %.2f/%.2f/%.2f", temperature_low_, temperature_high_, settings.temperature);
@@ -70,21 +67,13 @@ HeatpumpMode TwoPointHeatPump::GetDesiredMode() {
         return desired_mode_override_;
     }
 
-    int roomTemperature = getRoomTemperature();
-    if (roomTemperature <= temperature_low_) {
-        return HeatpumpMode::HEAT;
-    } else if (roomTemperature >= temperature_high_) {
-        return HeatpumpMode::COOL;
-    } else {
-        int distanceFromHeatPoint = abs(temperature_low_ - roomTemperature);
-        int distanceFromCoolPoint = abs(temperature_high_ - roomTemperature);
-
-        if (distanceFromHeatPoint < distanceFromCoolPoint) {
-            return HeatpumpMode::HEAT;
-        } else {
-            return HeatpumpMode::COOL;
-        }
+    float room_temperature = getRoomTemperature();
+    if (room_temperature == 0) {
+        // The library reports 0 until the unit's room temperature is read.
+        room_temperature = NAN;
     }
+    return mode_arbiter_.decide(
+        room_temperature, temperature_low_, temperature_high_, millis());
 }
 
 void TwoPointHeatPump::setDesiredModeOverride(HeatpumpMode heatPumpMode) {
@@ -95,30 +84,134 @@ void TwoPointHeatPump::setDesiredModeOverride(HeatpumpMode heatPumpMode) {
     if (managed_mode_) {
         HeatpumpMode previousMode = GetDesiredMode();
         desired_mode_override_ = heatPumpMode;
+        if (mode_override_changed_callback_) {
+            mode_override_changed_callback_(heatPumpMode);
+        }
 
-        if (previousMode != GetDesiredMode()) {
-            setModeSetting("DUAL_POINT");
+        // Until the unit's settings are known, the first sync that reads them
+        // configures the mode.
+        if (previousMode != GetDesiredMode() && readUnitSettings().isValid()) {
+            setModeSetting(HeatpumpModeSetting::DUAL_POINT);
             update();
         }
     }
 
 }
 
+void TwoPointHeatPump::restoreDesiredModeOverride(HeatpumpMode heatPumpMode) {
+    if (managed_mode_) {
+        desired_mode_override_ = heatPumpMode;
+    }
+}
+
 void TwoPointHeatPump::update() {
     ESP_LOGD("TwoPointHeatPump", "Update called");
     changes_pending_ = true;
+    writes_requested_++;
+}
+
+WriteResult TwoPointHeatPump::updateIfChangesPending() {
+    if (!changes_pending_) {
+        return WriteResult::WRITE_NONE;
+    }
+
+    changes_pending_ = false;
+    // The library leaves fields that match its last readback out of the SET,
+    // so a request undoing an unconfirmed write has to wait for the unit to
+    // report that write first.
+    uint8_t reverted = reconciler_.getReverted(pending_write_, readUnitSettings());
+    held_ = (held_ & ~pending_write_.dirty) | reverted;
+    pending_write_.dirty &= ~reverted;
+    if (pending_write_.dirty == 0) {
+        ESP_LOGD("TwoPointHeatPump", "Holding changes until the unit confirms the previous write");
+        return WriteResult::WRITE_NONE;
+    }
+    if (!pendingWriteDiffersFromUnit()) {
+        ESP_LOGD("TwoPointHeatPump", "Pending changes already match the unit, skipping write");
+        reconciler_.onSkipped(pending_write_);
+        pending_write_.dirty = 0;
+        return WriteResult::WRITE_SKIPPED;
+    }
+
+    // HeatPump::update() sends every wanted setting in one SET packet, only
+    // flagging the fields that differ from the unit.
+    PendingWrite written = pending_write_;
+    pending_write_.dirty = 0;
+    writes_sent_++;
+    bool acknowledged = HeatPump::update();
+    // Verified against the readback either way, an unacknowledged write is
+    // retried from there.
+    reconciler_.onWritten(written, millis());
+    return acknowledged ? WriteResult::WRITE_ACKNOWLEDGED : WriteResult::WRITE_FAILED;
 }
 
-void TwoPointHeatPump::updateIfChangesPending() {
-    if (changes_pending_) {
-        changes_pending_ = false;
-        HeatPump::update();
+boolean TwoPointHeatPump::pendingWriteDiffersFromUnit() {
+    HeatpumpSettingsModel settings = readUnitSettings();
+    if (!settings.isValid()) {
+        // Nothing read back from the unit yet, so nothing to compare against.
+        return true;
+    }
+
+    const PendingWrite& pending = pending_write_;
+    if ((pending.dirty & PendingWrite::POWER) && pending.power != settings.power) {
+        return true;
+    }
+    if ((pending.dirty & PendingWrite::MODE) && pending.mode != settings.mode) {
+        return true;
+    }
+    if ((pending.dirty & PendingWrite::TEMPERATURE) && pending.temperature != settings.temperature) {
+        return true;
+    }
+    if ((pending.dirty & PendingWrite::FAN) && pending.fan != settings.fan) {
+        return true;
     }
+    if ((pending.dirty & PendingWrite::VANE) && pending.vane != settings.vane) {
+        return true;
+    }
+    if ((pending.dirty & PendingWrite::WIDE_VANE) && pending.wideVane != settings.wideVane) {
+        return true;
+    }
+    return false;
+}
+
+HeatpumpSettingsModel TwoPointHeatPump::readUnitSettings() {
+    return settings_parser_.parse(HeatPump::getSettings());
+}
+
+HeatpumpSettingsModel TwoPointHeatPump::readReconciledSettings() {
+    HeatpumpSettingsModel settings = readUnitSettings();
+    reconciler_.apply(&settings);
+    if (held_ != 0 && settings.isValid()) {
+        PendingWrite held = pending_write_;
+        held.dirty = held_;
+        held.applyTo(&settings);
+    }
+    return settings;
+}
+
+void TwoPointHeatPump::setSettingsChangedCallback(std::function<void()> callback) {
+    settings_changed_callback_ = callback;
+    HeatPump::setSettingsChangedCallback(callback);
 }
 
 void TwoPointHeatPump::sync() {
     if (!changes_pending_) {
-        HeatPump::sync();
+        // The library cycles through six info packets, so settings come back
+        // only every 12 seconds or so. Ask for them directly while a write
+        // waits to be confirmed, or it times out and is retried regardless.
+        HeatPump::sync(reconciler_.hasInFlight() ? RQST_PKT_SETTINGS : PACKET_TYPE_DEFAULT);
+        PendingWrite retry;
+        if (reconciler_.onReadback(readUnitSettings(), millis(), &retry) &&
+            settings_changed_callback_) {
+            // The library only reports changes, and nothing changed on the
+            // unit, so report the value that's no longer being held back.
+            settings_changed_callback_();
+        }
+        if (retry.dirty != 0) {
+            queueRetry(retry);
+        }
+        releaseHeldFields();
+        mode_arbiter_.onCompressorState(getStatus().operating, millis());
 
         if (!ensureDesiredModeConfigured()) {
             return;
@@ -132,17 +225,17 @@ void TwoPointHeatPump::sync() {
 }
 
 HeatpumpMode TwoPointHeatPump::GetCurrentMode() {
-    heatpumpSettings settings = HeatPump::getSettings();
-    if (settings.power == NULL) {
+    HeatpumpSettingsModel settings = readReconciledSettings();
+    if (!settings.isValid()) {
         // Heatpump not fully initialized yet.
         return HeatpumpMode::UNKNOWN;
     }
 
-    if (strcmp(settings.power, "OFF") == 0) {
+    if (settings.power == HeatpumpPowerSetting::OFF) {
         return HeatpumpMode::OFF;
-    } else if (strcmp(settings.mode, "HEAT") == 0) {
+    } else if (settings.mode == HeatpumpModeSetting::HEAT) {
         return HeatpumpMode::HEAT;
-    } else if (strcmp(settings.mode, "COOL") == 0) {
+    } else if (settings.mode == HeatpumpModeSetting::COOL) {
         return HeatpumpMode::COOL;
     } else {
         return HeatpumpMode::UNKNOWN;
@@ -150,35 +243,121 @@ HeatpumpMode TwoPointHeatPump::GetCurrentMode() {
 
 }
 
-void TwoPointHeatPump::setPowerSetting(const char* setting) {
-    if (strcmp(setting, "OFF") == 0) {
+void TwoPointHeatPump::setPowerSetting(HeatpumpPowerSetting setting) {
+    if (setting == HeatpumpPowerSetting::OFF) {
         managed_mode_ = false;
     }
 
-    HeatPump::setPowerSetting(setting);
+    queuePowerSetting(setting);
+}
+
+void TwoPointHeatPump::setTemperature(float setting) {
+    pending_write_.temperature = setting;
+    pending_write_.markDirty(PendingWrite::TEMPERATURE, millis());
+    HeatPump::setTemperature(setting);
+}
+
+void TwoPointHeatPump::setFanSpeed(HeatpumpFanSetting setting) {
+    pending_write_.fan = setting;
+    pending_write_.markDirty(PendingWrite::FAN, millis());
+    HeatPump::setFanSpeed(toString(setting));
+}
+
+void TwoPointHeatPump::setVaneSetting(HeatpumpVaneSetting setting) {
+    pending_write_.vane = setting;
+    pending_write_.markDirty(PendingWrite::VANE, millis());
+    HeatPump::setVaneSetting(toString(setting));
 }
 
-void TwoPointHeatPump::setModeSetting(const char* setting) {
-    ESP_LOGD("TwoPointHeatPump", "SetModeSetting: %s", setting);
+void TwoPointHeatPump::setWideVaneSetting(HeatpumpWideVaneSetting setting) {
+    pending_write_.wideVane = setting;
+    pending_write_.markDirty(PendingWrite::WIDE_VANE, millis());
+    HeatPump::setWideVaneSetting(toString(setting));
+}
+
+void TwoPointHeatPump::queueRetry(const PendingWrite& retry) {
+    // Anything requested since takes precedence over the retry. A held
+    // request would be overwritten by it, so it keeps waiting instead.
+    reconciler_.onRetryHeld(retry.dirty & held_, millis());
+    uint8_t fields = retry.dirty & ~pending_write_.dirty & ~held_;
+    queueFields(retry, fields);
+    if (fields != 0) {
+        update();
+    }
+}
+
+void TwoPointHeatPump::releaseHeldFields() {
+    uint8_t released = held_ & ~reconciler_.getInFlight();
+    if (released == 0) {
+        return;
+    }
+
+    held_ &= ~released;
+    // Set again, as the library may have taken the unit's value as wanted
+    // since.
+    PendingWrite held = pending_write_;
+    queueFields(held, released);
+    update();
+}
+
+void TwoPointHeatPump::queueFields(const PendingWrite& source, uint8_t fields) {
+    if (fields & PendingWrite::POWER) {
+        queuePowerSetting(source.power);
+    }
+    if (fields & PendingWrite::MODE) {
+        queueModeSetting(source.mode);
+    }
+    if (fields & PendingWrite::TEMPERATURE) {
+        setTemperature(source.temperature);
+    }
+    if (fields & PendingWrite::FAN) {
+        setFanSpeed(source.fan);
+    }
+    if (fields & PendingWrite::VANE) {
+        setVaneSetting(source.vane);
+    }
+    if (fields & PendingWrite::WIDE_VANE) {
+        setWideVaneSetting(source.wideVane);
+    }
+}
+
+void TwoPointHeatPump::queuePowerSetting(HeatpumpPowerSetting setting) {
+    pending_write_.power = setting;
+    pending_write_.markDirty(PendingWrite::POWER, millis());
+    HeatPump::setPowerSetting(toString(setting));
+}
+
+void TwoPointHeatPump::queueModeSetting(HeatpumpModeSetting setting) {
+    pending_write_.mode = setting;
+    pending_write_.markDirty(PendingWrite::MODE, millis());
+    HeatPump::setModeSetting(toString(setting));
+}
+
+void TwoPointHeatPump::setModeSetting(HeatpumpModeSetting setting) {
+    ESP_LOGD("TwoPointHeatPump", "SetModeSetting: %s", toString(setting));
     // TODO: Add override for two point here.
-    if (strcmp(setting, "DUAL_POINT") == 0) {
+    if (setting == HeatpumpModeSetting::DUAL_POINT) {
+        if (!managed_mode_) {
+            // Keep whatever the unit is already doing if it fits.
+            mode_arbiter_.seed(GetCurrentMode());
+        }
         managed_mode_ = true;
 
         HeatpumpMode desiredMode = GetDesiredMode();
         float temperature = 0;
-        std::string powerSetting = "ON";
+        HeatpumpPowerSetting powerSetting = HeatpumpPowerSetting::ON;
         if (desiredMode == HeatpumpMode::HEAT) {
             ESP_LOGD("TwoPointHeatPump", "Modifying setting to HEAT mode");
             temperature = temperature_low_;
-            setting = "HEAT";
-            powerSetting = "ON";
+            setting = HeatpumpModeSetting::HEAT;
+            powerSetting = HeatpumpPowerSetting::ON;
         } else if (desiredMode == HeatpumpMode::COOL) {
             ESP_LOGD("TwoPointHeatPump", "Modifying setting to COOL mode");
             temperature = temperature_high_;
-            setting = "COOL";
-            powerSetting = "ON";
+            setting = HeatpumpModeSetting::COOL;
+            powerSetting = HeatpumpPowerSetting::ON;
         } else if (desiredMode == HeatpumpMode::OFF) {
-            powerSetting = "OFF";
+            powerSetting = HeatpumpPowerSetting::OFF;
         } else {
             ESP_LOGD("TwoPointHeatPump", "Dont know what to modify setting to, returning");
             return;
@@ -187,19 +366,19 @@ void TwoPointHeatPump::setModeSetting(const char* setting) {
         if (temperature > 0) {
             setTemperature(temperature);
         }
-        HeatPump::setPowerSetting(powerSetting.c_str());
+        queuePowerSetting(powerSetting);
 
-        if (strcmp(setting, "DUAL_POINT") != 0) {
-            HeatPump::setModeSetting(setting);
+        if (setting != HeatpumpModeSetting::DUAL_POINT) {
+            queueModeSetting(setting);
         }
     } else {
         managed_mode_ = false;
 
-        HeatPump::setModeSetting(setting);
+        queueModeSetting(setting);
     }
 }
 
-String heatpumpModeToString(HeatpumpMode mode) {
+static const char* heatpumpModeToString(HeatpumpMode mode) {
     switch(mode) {
         case HeatpumpMode::HEAT:
             return "HEAT";
@@ -232,13 +411,13 @@ void TwoPointHeatPump::setTemperatureHigh(float setting) {
 }
 
 boolean TwoPointHeatPump::ensureDesiredModeConfigured() {
-    if (managed_mode_) {
+    if (managed_mode_ && readUnitSettings().isValid()) {
         HeatpumpMode currentMode = GetCurrentMode();
         HeatpumpMode desiredMode = GetDesiredMode();
-        if (currentMode != desiredMode) {
+        if (currentMode != desiredMode && desiredMode != HeatpumpMode::UNKNOWN) {
             ESP_LOGD("TwoPointHeatPump", "room_temperature_update():: Current mode is not desired mode, attempting update from %s to %s", 
                 heatpumpModeToString(currentMode), heatpumpModeToString(desiredMode));
-            setModeSetting("DUAL_POINT");
+            setModeSetting(HeatpumpModeSetting::DUAL_POINT);
             update();
             return false;
         }
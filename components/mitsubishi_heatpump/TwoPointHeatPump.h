@@ -12,17 +12,27 @@
 #define TWOPOINTHEATPUMP_H
 
 #include "HeatPump.h"
+#include "CommandReconciler.h"
+#include "HeatpumpSettings.h"
+#include "ModeArbiter.h"
 
-struct twoPointHeatPumpSettings : heatpumpSettings {
+struct twoPointHeatPumpSettings : HeatpumpSettingsModel {
     float temperature_low;
     float temperature_high;
 };
 
-enum HeatpumpMode {
-    UNKNOWN,
-    OFF,
-    COOL,
-    HEAT
+// Outcome of updateIfChangesPending().
+enum WriteResult {
+    // Nothing was pending, or only requests held until the unit confirms
+    // an earlier write.
+    WRITE_NONE,
+    // Changes were pending, but the unit already reported those values so
+    // no packet was sent.
+    WRITE_SKIPPED,
+    // A SET packet was sent and acknowledged by the unit.
+    WRITE_ACKNOWLEDGED,
+    // A SET packet was sent but the unit didn't acknowledge it.
+    WRITE_FAILED
 };
 
 class TwoPointHeatPump : public HeatPump {
@@ -36,14 +46,50 @@ public:
     twoPointHeatPumpSettings getSettings();
     void setTemperatureLow(float setting);
     void setTemperatureHigh(float setting);
-    void setModeSetting(const char* setting);
-    void setPowerSetting(const char* setting);
+    void setModeSetting(HeatpumpModeSetting setting);
+    void setPowerSetting(HeatpumpPowerSetting setting);
+    void setTemperature(float setting);
+    void setFanSpeed(HeatpumpFanSetting setting);
+    void setVaneSetting(HeatpumpVaneSetting setting);
+    void setWideVaneSetting(HeatpumpWideVaneSetting setting);
 
     void setDesiredModeOverride(HeatpumpMode heatPumpMode);
+    HeatpumpMode getDesiredModeOverride() { return desired_mode_override_; }
+
+    // Restores an override saved before a reboot. Unlike
+    // setDesiredModeOverride() this doesn't request a write, the override is
+    // applied by the first sync once the unit's settings are known.
+    void restoreDesiredModeOverride(HeatpumpMode heatPumpMode);
+
+    // Called when setDesiredModeOverride() changes the override.
+    void setModeOverrideChangedCallback(std::function<void(HeatpumpMode)> callback) {
+        mode_override_changed_callback_ = callback;
+    }
+
+    // Also kept here, to report fields the reconciler stops holding back.
+    void setSettingsChangedCallback(std::function<void()> callback);
+
+    // Holds back stale readbacks of recently written fields.
+    const CommandReconciler& getReconciler() { return reconciler_; }
+
+    void setModeArbiterConfig(const ModeArbiterConfig& config) { mode_arbiter_.setConfig(config); }
+    const ModeArbiter& getModeArbiter() { return mode_arbiter_; }
 
     void update();
 
-    void updateIfChangesPending();
+    // Writes any pending changes to the heatpump. Any number of update()
+    // calls since the previous write are merged into a single SET packet,
+    // and the write is dropped entirely if the unit already reports the
+    // requested values. Requests that would undo a write the unit hasn't
+    // confirmed yet are held until it does.
+    WriteResult updateIfChangesPending();
+
+    boolean hasChangesPending() { return changes_pending_; }
+
+    // Number of update() calls, and the number of SET packets actually
+    // written as a result of them.
+    uint32_t getWritesRequested() { return writes_requested_; }
+    uint32_t getWritesSent() { return writes_sent_; }
 
     void sync();
 
@@ -55,19 +101,59 @@ private:
 
     // Ensures the heatpump is configured correctly to HEAT/COOL if
     // managed mode is enabled. Returns true if it was already configured
-    // correctly, or false if it will be configured.
+    // correctly, or false if it will be configured. Nothing is queued until
+    // the unit's settings are known: a pending write stops sync() reading
+    // them, and writes are held until they're read.
     boolean ensureDesiredModeConfigured();
 
     float nearestHalf(float input);
+
+    // Returns true if any dirty field in pending_write_ differs from the
+    // last settings read back from the unit.
+    boolean pendingWriteDiffersFromUnit();
+
+    void queuePowerSetting(HeatpumpPowerSetting setting);
+    void queueModeSetting(HeatpumpModeSetting setting);
+
+    // Writes fields the unit didn't confirm again.
+    void queueRetry(const PendingWrite& retry);
+
+    // Queues held fields again once the write they undo is no longer in
+    // flight.
+    void releaseHeldFields();
+
+    // Queues fields of source through the setters above.
+    void queueFields(const PendingWrite& source, uint8_t fields);
+
+    // Returns the settings last read back from the unit.
+    HeatpumpSettingsModel readUnitSettings();
+
+    // Returns the settings last read back from the unit, with any written
+    // fields the unit hasn't confirmed yet replaced by the written values.
+    HeatpumpSettingsModel readReconciledSettings();
     
-    // Returns the correct mode (HEAT/COOL) if managed mode is enabled. If
-    // managed mode is disabled, it will simply return GetCurrentMode().
+    // Returns the correct mode (HEAT/COOL) if managed mode is enabled, as
+    // chosen by the mode arbiter. If managed mode is disabled, it will simply
+    // return GetCurrentMode().
     HeatpumpMode GetDesiredMode();
 
     // Returns the currently configured mode on the heat pump.
     HeatpumpMode GetCurrentMode();
 
+    HeatpumpSettingsParser settings_parser_;
+    ModeArbiter mode_arbiter_;
     boolean changes_pending_ = false;
+    PendingWrite pending_write_;
+    // Requested fields held back because they'd undo a write the unit hasn't
+    // confirmed yet. They match its readback, which may be stale, so the
+    // library would leave them out of the SET. Their values stay in
+    // pending_write_ until they're released.
+    uint8_t held_ = 0;
+    CommandReconciler reconciler_;
+    std::function<void()> settings_changed_callback_;
+    std::function<void(HeatpumpMode)> mode_override_changed_callback_;
+    uint32_t writes_requested_ = 0;
+    uint32_t writes_sent_ = 0;
     HeatpumpMode desired_mode_override_ = HeatpumpMode::UNKNOWN;
     boolean managed_mode_ = false;
     float temperature_low_;
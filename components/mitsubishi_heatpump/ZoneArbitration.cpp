@@ -0,0 +1,43 @@
+/**
+ * ZoneArbitration.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "ZoneArbitration.h"
+
+using esphome::esp_log_printf_;
+
+float MaxDeltaArbitration::demand(const ZoneTable& zones, uint32_t /* now_ms */) {
+    float max_heat = zones.maxHeatDelta();
+    float max_cool = zones.maxCoolDelta();
+    return max_cool > -max_heat ? max_cool : max_heat;
+}
+
+float SumOfDeficitsArbitration::demand(const ZoneTable& zones, uint32_t /* now_ms */) {
+    return zones.weightedDeltaSum();
+}
+
+float TimeSlicedArbitration::demand(const ZoneTable& zones, uint32_t now_ms) {
+    float max_heat = zones.maxHeatDelta();
+    float max_cool = zones.maxCoolDelta();
+
+    if (max_heat == 0 || max_cool == 0) {
+        // At most one side wants anything, no one to be fair to.
+        serving_ = max_heat < 0 ? -1 : (max_cool > 0 ? 1 : 0);
+        slice_started_at_ = now_ms;
+        return max_heat < 0 ? max_heat : max_cool;
+    }
+
+    if (serving_ == 0) {
+        serving_ = -max_heat > max_cool ? -1 : 1;
+        slice_started_at_ = now_ms;
+    } else if (now_ms - slice_started_at_ >= SLICE_MS) {
+        ESP_LOGD("ZoneArbitration", "Slice over, switching to %s", serving_ < 0 ? "cool" : "heat");
+        serving_ = -serving_;
+        slice_started_at_ = now_ms;
+    }
+
+    return serving_ < 0 ? max_heat : max_cool;
+}
@@ -0,0 +1,67 @@
+/**
+ * ZoneArbitration.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef ZONEARBITRATION_H
+#define ZONEARBITRATION_H
+
+#include "esphome.h"
+#include "ZoneTable.h"
+
+// Strategies deciding whether a multisplit should heat or cool, given every
+// zone's distance from its setpoints. Each returns the demand of the
+// multisplit: negative asks for heat, positive for cool, and anything within
+// ZoneConsistencyController's threshold keeps the previous mode.
+//
+// The strategy is chosen at compile time with the arbitration option, so
+// only the selected one is built into the firmware. Each reads the aggregates
+// ZoneTable maintains, so a decision costs the same however many zones
+// report.
+
+// Serves whichever zone is furthest from its setpoints.
+class MaxDeltaArbitration {
+public:
+    static const char* name() { return "max delta"; }
+    float demand(const ZoneTable& zones, uint32_t now_ms);
+};
+
+// Serves the side with the largest total deficit, each zone's delta
+// weighted by its zone_weight.
+class SumOfDeficitsArbitration {
+public:
+    static const char* name() { return "sum of deficits"; }
+    float demand(const ZoneTable& zones, uint32_t now_ms);
+};
+
+// Serves the furthest zone like max delta, but while zones on both sides
+// have demand, the multisplit alternates between heating and cooling every
+// slice so neither side is starved.
+class TimeSlicedArbitration {
+public:
+#ifdef ESPMHP_ARBITRATION_SLICE_MINUTES
+    static const uint32_t SLICE_MS = ESPMHP_ARBITRATION_SLICE_MINUTES * 60 * 1000;
+#else
+    static const uint32_t SLICE_MS = 30 * 60 * 1000;
+#endif
+
+    static const char* name() { return "time sliced"; }
+    float demand(const ZoneTable& zones, uint32_t now_ms);
+
+private:
+    // Side currently being served, -1 for heat, 1 for cool, 0 for none.
+    int8_t serving_ = 0;
+    uint32_t slice_started_at_ = 0;
+};
+
+#if defined(ESPMHP_ARBITRATION_SUM_OF_DEFICITS)
+typedef SumOfDeficitsArbitration ZoneArbitration;
+#elif defined(ESPMHP_ARBITRATION_TIME_SLICED)
+typedef TimeSlicedArbitration ZoneArbitration;
+#else
+typedef MaxDeltaArbitration ZoneArbitration;
+#endif
+
+#endif
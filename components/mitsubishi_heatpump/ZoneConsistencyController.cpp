@@ -24,31 +24,58 @@ void ZoneConsistencyController::zoneUpdate(
     float temperature_low,
     float temperature_high,
     float current_temperature) {
-    if (remote_temperature_data_.count(device_name) > 0) {
-        delete remote_temperature_data_[device_name];
-    }
+    zoneUpdate(
+        ZoneTable::internId(device_name),
+        state == "heat_cool",
+        temperature_low,
+        temperature_high,
+        current_temperature);
+}
 
-    if (state == "heat_cool") {
-        remote_temperature_data_[device_name] = new RemoteTemperatureData(
+void ZoneConsistencyController::zoneUpdate(
+    uint32_t zone_id,
+    bool heat_cool,
+    float temperature_low,
+    float temperature_high,
+    float current_temperature,
+    float weight) {
+    if (heat_cool) {
+        zones_.update(
+            zone_id,
             temperature_low,
             temperature_high,
-            current_temperature);
+            current_temperature,
+            weight,
+            millis());
     } else {
-        remote_temperature_data_.erase(device_name);
+        zones_.remove(zone_id);
     }
 
     assignDominantSetting();
 }
 
-int ZoneConsistencyController::calculateDelta(RemoteTemperatureData* remoteTemperatureData) {
-    float delta = 0;
-    if (remoteTemperatureData->temperature_current_ < remoteTemperatureData->temperature_low_) {
-        delta = remoteTemperatureData->temperature_current_ - remoteTemperatureData->temperature_low_;
-    } else if (remoteTemperatureData->temperature_current_ > remoteTemperatureData->temperature_high_) {
-        delta = remoteTemperatureData->temperature_current_ - remoteTemperatureData->temperature_high_;
+void ZoneConsistencyController::setZoneExpiry(uint32_t expiry_ms) {
+    zone_expiry_ = expiry_ms;
+}
+
+void ZoneConsistencyController::expireStaleZones() {
+    if (zone_expiry_ == 0) {
+        return;
+    }
+
+    if (zones_.expire(millis(), zone_expiry_) > 0) {
+        assignDominantSetting();
     }
+}
 
-    return delta;
+bool ZoneConsistencyController::nextZoneExpiry(uint32_t* due_ms) {
+    uint32_t updated_at;
+    if (zone_expiry_ == 0 || !zones_.oldestUpdate(&updated_at)) {
+        return false;
+    }
+    // Zones expire once they are strictly older than the expiry.
+    *due_ms = updated_at + zone_expiry_ + 1;
+    return true;
 }
 
 void ZoneConsistencyController::assignDominantSetting() {
@@ -58,32 +85,25 @@ void ZoneConsistencyController::assignDominantSetting() {
     }
 
     twoPointHeatPumpSettings currentSettings = hp_->getSettings();
-    if (strcmp(currentSettings.mode, "DUAL_POINT") != 0) {
+    if (currentSettings.mode != HeatpumpModeSetting::DUAL_POINT) {
         ESP_LOGD("ZoneConsistencyController", "HP not set to dual point, wont update");
         return;
     }
 
 
-    float maxDelta = 0;
     HeatpumpMode mode = HeatpumpMode::UNKNOWN;
+    float demand = arbitration_.demand(zones_, millis());
 
-
-    for (auto const& kvp : remote_temperature_data_) {
-        if (abs(calculateDelta(kvp.second)) > abs(maxDelta)) {
-            maxDelta = calculateDelta(kvp.second);
-        }
-    }
-
-    if (maxDelta < -0.1) {
-        ESP_LOGD("ZoneConsistencyController", "Max Delta=%f, assigning heat.", maxDelta);
+    if (demand < -0.1) {
+        ESP_LOGD("ZoneConsistencyController", "Demand=%f (%s), assigning heat.", demand, ZoneArbitration::name());
 
         if (hp_->getRoomTemperature() <= currentSettings.temperature_low) {
             mode = HeatpumpMode::HEAT;
         } else {
             mode = HeatpumpMode::OFF;
         }
-    } else if (maxDelta > 0.1) {
-        ESP_LOGD("ZoneConsistencyController", "Max Delta=%f, assigning cool.", maxDelta);
+    } else if (demand > 0.1) {
+        ESP_LOGD("ZoneConsistencyController", "Demand=%f (%s), assigning cool.", demand, ZoneArbitration::name());
 
         if (hp_->getRoomTemperature() >= currentSettings.temperature_high) {
             mode = HeatpumpMode::COOL;
@@ -11,27 +11,10 @@
 #ifndef ZONECONSISTENCYCONTROLLER_H
 #define ZONECONSISTENCYCONTROLLER_H
 
-#include <chrono>
-#include <map>
 #include <string>
 #include "TwoPointHeatPump.h"
-
-class RemoteTemperatureData {
-public:
-    RemoteTemperatureData(
-        float temperature_low,
-        float temperature_high,
-        float temperature_current) :
-            creation_time_(std::chrono::steady_clock::now()),
-            temperature_low_(temperature_low),
-            temperature_high_(temperature_high),
-            temperature_current_(temperature_current) {};
-
-    const std::chrono::time_point<std::chrono::steady_clock> creation_time_;
-    const float temperature_low_;
-    const float temperature_high_;
-    const float temperature_current_;
-};
+#include "ZoneArbitration.h"
+#include "ZoneTable.h"
 
 class ZoneConsistencyController {
 public:
@@ -41,6 +24,27 @@ public:
                     float temperature_high,
                     float temperature_current);
 
+    // As above, for a zone identified by its interned id. heat_cool is true
+    // if the zone is in heat_cool mode.
+    void zoneUpdate(uint32_t zone_id,
+                    bool heat_cool,
+                    float temperature_low,
+                    float temperature_high,
+                    float temperature_current,
+                    float weight = 1);
+
+    // Zones that haven't reported for longer than this are forgotten, so a
+    // dead neighbor can't hold the multisplit in one mode. 0 disables expiry.
+    void setZoneExpiry(uint32_t expiry_ms);
+
+    // Forgets zones older than the zone expiry, reassigning the dominant
+    // setting if any were removed.
+    void expireStaleZones();
+
+    // Returns false if no zone can expire, otherwise the time at which the
+    // next zone goes stale.
+    bool nextZoneExpiry(uint32_t* due_ms);
+
     void assignDominantSetting();
 
     void setHeatpumpController(TwoPointHeatPump* hp);
@@ -48,11 +52,11 @@ public:
     void update();
 
 private:
-    std::map<std::string, RemoteTemperatureData*> remote_temperature_data_;
+    ZoneTable zones_;
+    uint32_t zone_expiry_ = 0;
     TwoPointHeatPump* hp_ = nullptr;
     HeatpumpMode previous_mode_ = HeatpumpMode::UNKNOWN;
-    
-    int calculateDelta(RemoteTemperatureData* remoteTemperatureData);
+    ZoneArbitration arbitration_;
 };
 
 #endif
\ No newline at end of file
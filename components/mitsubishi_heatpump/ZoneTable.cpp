@@ -0,0 +1,182 @@
+/**
+ * ZoneTable.cpp
+ *
+ * License: BSD
+ *
+ */
+
+#include "ZoneTable.h"
+#include "esphome.h"
+#include <algorithm>
+#include <cmath>
+
+using esphome::esp_log_printf_;
+
+float zoneDelta(const Zone& zone) {
+    if (zone.temperature_current < zone.temperature_low) {
+        return zone.temperature_current - zone.temperature_low;
+    } else if (zone.temperature_current > zone.temperature_high) {
+        return zone.temperature_current - zone.temperature_high;
+    }
+    return 0;
+}
+
+ZoneTable::ZoneTable() {
+    for (Summary& node : tree_) {
+        node = Summary{0, 0, NO_ZONE};
+    }
+}
+
+uint32_t ZoneTable::internId(const std::string& name) {
+    // 32 bit FNV-1a.
+    uint32_t hash = 2166136261UL;
+    for (char c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+void ZoneTable::update(
+    uint32_t id,
+    float temperature_low,
+    float temperature_high,
+    float temperature_current,
+    float weight,
+    uint32_t now_ms) {
+    int index = find(id);
+    if (index < 0) {
+        if (size_ == CAPACITY) {
+            // Replace the zone that has gone longest without reporting.
+            uint8_t oldest = tree_[1].oldest;
+            ESP_LOGW("ZoneTable", "Zone table full, replacing zone %08x", zones_[oldest].id);
+            removeAt(oldest);
+        }
+
+        index = size_++;
+        zones_[index].weighted_delta_milli = 0;
+
+        // Insert into the id index, keeping it sorted.
+        uint8_t position = std::lower_bound(index_ids_, index_ids_ + size_ - 1, id) - index_ids_;
+        for (uint8_t i = size_ - 1; i > position; i--) {
+            index_ids_[i] = index_ids_[i - 1];
+            index_slots_[i] = index_slots_[i - 1];
+        }
+        index_ids_[position] = id;
+        index_slots_[position] = index;
+    }
+
+    Zone& zone = zones_[index];
+    zone.id = id;
+    zone.updated_at = now_ms;
+    zone.temperature_low = temperature_low;
+    zone.temperature_high = temperature_high;
+    zone.temperature_current = temperature_current;
+    zone.weight = weight;
+    zone.delta = zoneDelta(zone);
+
+    weighted_delta_sum_milli_ -= zone.weighted_delta_milli;
+    zone.weighted_delta_milli = lroundf(weight * zone.delta * 1000);
+    weighted_delta_sum_milli_ += zone.weighted_delta_milli;
+
+    refresh(index);
+}
+
+bool ZoneTable::remove(uint32_t id) {
+    int index = find(id);
+    if (index < 0) {
+        return false;
+    }
+    removeAt(index);
+    return true;
+}
+
+uint8_t ZoneTable::expire(uint32_t now_ms, uint32_t max_age_ms) {
+    uint8_t removed = 0;
+    uint8_t i = 0;
+    while (i < size_) {
+        if (now_ms - zones_[i].updated_at > max_age_ms) {
+            ESP_LOGW("ZoneTable", "Zone %08x hasn't reported in %u ms, removing it", zones_[i].id, now_ms - zones_[i].updated_at);
+            removeAt(i);
+            removed++;
+        } else {
+            i++;
+        }
+    }
+    return removed;
+}
+
+bool ZoneTable::oldestUpdate(uint32_t* updated_at) const {
+    if (size_ == 0) {
+        return false;
+    }
+    *updated_at = zones_[tree_[1].oldest].updated_at;
+    return true;
+}
+
+float ZoneTable::maxHeatDelta() const {
+    return tree_[1].min_delta < 0 ? tree_[1].min_delta : 0;
+}
+
+float ZoneTable::maxCoolDelta() const {
+    return tree_[1].max_delta > 0 ? tree_[1].max_delta : 0;
+}
+
+int ZoneTable::find(uint32_t id) const {
+    const uint32_t* position = std::lower_bound(index_ids_, index_ids_ + size_, id);
+    if (position == index_ids_ + size_ || *position != id) {
+        return -1;
+    }
+    return index_slots_[position - index_ids_];
+}
+
+void ZoneTable::removeAt(uint8_t index) {
+    weighted_delta_sum_milli_ -= zones_[index].weighted_delta_milli;
+
+    // Drop the zone from the id index, and point the last zone's entry at
+    // the slot it's about to move into.
+    uint8_t position = std::lower_bound(index_ids_, index_ids_ + size_, zones_[index].id) - index_ids_;
+    for (uint8_t i = position; i + 1 < size_; i++) {
+        index_ids_[i] = index_ids_[i + 1];
+        index_slots_[i] = index_slots_[i + 1];
+    }
+
+    // Keep the table densely packed by moving the last zone into the gap.
+    size_--;
+    if (index != size_) {
+        zones_[index] = zones_[size_];
+        position = std::lower_bound(index_ids_, index_ids_ + size_, zones_[index].id) - index_ids_;
+        index_slots_[position] = index;
+        refresh(index);
+    }
+    refresh(size_);
+}
+
+void ZoneTable::refresh(uint8_t slot) {
+    uint8_t node = CAPACITY + slot;
+    if (slot < size_) {
+        tree_[node] = Summary{zones_[slot].delta, zones_[slot].delta, slot};
+    } else {
+        tree_[node] = Summary{0, 0, NO_ZONE};
+    }
+
+    for (node /= 2; node > 0; node /= 2) {
+        tree_[node] = combine(tree_[2 * node], tree_[2 * node + 1]);
+    }
+}
+
+ZoneTable::Summary ZoneTable::combine(const Summary& a, const Summary& b) const {
+    Summary result;
+    result.min_delta = a.min_delta < b.min_delta ? a.min_delta : b.min_delta;
+    result.max_delta = a.max_delta > b.max_delta ? a.max_delta : b.max_delta;
+    if (a.oldest == NO_ZONE) {
+        result.oldest = b.oldest;
+    } else if (b.oldest == NO_ZONE) {
+        result.oldest = a.oldest;
+    } else {
+        // Wrap safe as long as the reports are less than 24 days apart.
+        int32_t difference = zones_[a.oldest].updated_at - zones_[b.oldest].updated_at;
+        result.oldest = difference <= 0 ? a.oldest : b.oldest;
+    }
+    return result;
+}
@@ -0,0 +1,115 @@
+/**
+ * ZoneTable.h
+ *
+ * License: BSD
+ *
+ */
+
+#ifndef ZONETABLE_H
+#define ZONETABLE_H
+
+#include <stdint.h>
+#include <string>
+
+// Latest report from a neighboring zone on the same multisplit.
+struct Zone {
+    uint32_t id;
+    uint32_t updated_at;
+    float temperature_low;
+    float temperature_high;
+    float temperature_current;
+    // Relative importance of the zone for arbitration strategies that
+    // weigh zones against each other.
+    float weight;
+    // zoneDelta() of the report, and weight times that in thousandths of a
+    // degree.
+    float delta;
+    int32_t weighted_delta_milli;
+};
+
+// How far the zone is outside its setpoints: negative when below the low
+// setpoint, positive when above the high setpoint, otherwise 0.
+float zoneDelta(const Zone& zone);
+
+// Fixed capacity table of neighboring zones.
+//
+// Zones are kept densely packed in a flat array, so reports never allocate
+// and iterating over the zones touches a single contiguous block. Zones are
+// identified by an interned id rather than their entity name.
+//
+// The aggregates the arbitration strategies need are maintained as zones
+// report rather than recomputed from every zone: a tournament tree over the
+// slots tracks the largest heat and cool deltas and the least recently
+// reporting zone, and a fixed point running sum tracks the weighted deltas.
+// A report from a known zone costs a binary search plus one path up the
+// tree, O(log n). Adding or removing a zone also shifts the sorted id index,
+// which is O(n) but only a short move of at most CAPACITY entries.
+class ZoneTable {
+public:
+    // Must be a power of two.
+    static const uint8_t CAPACITY = 64;
+    static const uint8_t NO_ZONE = 0xFF;
+
+    ZoneTable();
+
+    // Returns the interned id for a zone's entity name.
+    static uint32_t internId(const std::string& name);
+
+    // Records a report for the zone, adding it to the table if needed. If
+    // the table is full, the zone that reported least recently is replaced.
+    void update(uint32_t id,
+                float temperature_low,
+                float temperature_high,
+                float temperature_current,
+                float weight,
+                uint32_t now_ms);
+
+    // Removes the zone. Returns true if it was present.
+    bool remove(uint32_t id);
+
+    // Removes every zone that hasn't reported for longer than max_age_ms.
+    // Returns the number of zones removed.
+    uint8_t expire(uint32_t now_ms, uint32_t max_age_ms);
+
+    // Returns false if the table is empty, otherwise when the zone that
+    // reported least recently last reported.
+    bool oldestUpdate(uint32_t* updated_at) const;
+
+    // Most negative zone delta, or 0 if no zone is below its low setpoint.
+    float maxHeatDelta() const;
+    // Most positive zone delta, or 0 if no zone is above its high setpoint.
+    float maxCoolDelta() const;
+    // Sum of every zone's weight times its delta.
+    float weightedDeltaSum() const { return weighted_delta_sum_milli_ / 1000.0f; }
+
+    uint8_t size() const { return size_; }
+    const Zone& operator[](uint8_t index) const { return zones_[index]; }
+
+private:
+    // Aggregate over a subtree of slots.
+    struct Summary {
+        float min_delta;
+        float max_delta;
+        uint8_t oldest;
+    };
+
+    int find(uint32_t id) const;
+    void removeAt(uint8_t index);
+
+    // Recomputes the leaf for slot and its path to the root.
+    void refresh(uint8_t slot);
+    Summary combine(const Summary& a, const Summary& b) const;
+
+    Zone zones_[CAPACITY];
+    uint8_t size_ = 0;
+
+    // Zone ids in ascending order, and the slot of each.
+    uint32_t index_ids_[CAPACITY];
+    uint8_t index_slots_[CAPACITY];
+
+    // Node 1 is the root, the leaf for slot i is node CAPACITY + i.
+    Summary tree_[2 * CAPACITY];
+    int32_t weighted_delta_sum_milli_ = 0;
+};
+
+#endif
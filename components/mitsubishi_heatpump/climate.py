@@ -1,6 +1,7 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import climate, select
+import esphome.final_validate as fv
+from esphome.components import climate, select, sensor
 from esphome.components.logger import HARDWARE_UART_TO_SERIAL
 from esphome.const import (
     CONF_ID,
@@ -13,11 +14,18 @@ from esphome.const import (
     CONF_MODE,
     CONF_FAN_MODE,
     CONF_SWING_MODE,
+    CONF_PLATFORM,
+    CONF_PORT,
+    CONF_SENSOR,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    PLATFORM_ESP32,
     PLATFORM_ESP8266
 )
 from esphome.core import CORE, coroutine
 
-AUTO_LOAD = ["climate", "select"]
+AUTO_LOAD = ["climate", "select", "sensor"]
 
 CONF_SUPPORTS = "supports"
 CONF_HORIZONTAL_SWING_SELECT = "horizontal_vane_select"
@@ -25,21 +33,107 @@ CONF_VERTICAL_SWING_SELECT = "vertical_vane_select"
 DEFAULT_CLIMATE_MODES = ["HEAT_COOL", "COOL", "HEAT", "DRY", "FAN_ONLY"]
 DEFAULT_FAN_MODES = ["AUTO", "DIFFUSE", "LOW", "MEDIUM", "MIDDLE", "HIGH"]
 DEFAULT_SWING_MODES = ["OFF", "VERTICAL", "HORIZONTAL", "BOTH"]
+# Vane select options. The option index is used as the HeatpumpVaneSetting /
+# HeatpumpWideVaneSetting value, keep these in the order of
+# ESPMHP_VERTICAL_VANE_OPTIONS / ESPMHP_HORIZONTAL_VANE_OPTIONS in espmhp.h.
 HORIZONTAL_SWING_OPTIONS = [
-    "auto",
-    "swing",
     "left",
     "left_center",
     "center",
     "right_center",
     "right",
+    "auto",
+    "swing",
 ]
-VERTICAL_SWING_OPTIONS = ["swing", "auto", "up", "up_center", "center", "down_center", "down"]
+VERTICAL_SWING_OPTIONS = ["auto", "up", "up_center", "center", "down_center", "down", "swing"]
 
 # Remote temperature timeout configuration
 CONF_REMOTE_OPERATING_TIMEOUT = "remote_temperature_operating_timeout_minutes"
 CONF_REMOTE_IDLE_TIMEOUT = "remote_temperature_idle_timeout_minutes"
 CONF_REMOTE_PING_TIMEOUT = "remote_temperature_ping_timeout_minutes"
+CONF_ZONE_EXPIRY = "zone_expiry_minutes"
+CONF_ZONE_WEIGHT = "zone_weight"
+
+# Multizone arbitration strategy, compiled in through a define
+CONF_ARBITRATION = "arbitration"
+CONF_SLICE = "slice"
+ARBITRATION_DEFINES = {
+    "max_delta": None,
+    "sum_of_deficits": "ESPMHP_ARBITRATION_SUM_OF_DEFICITS",
+    "time_sliced": "ESPMHP_ARBITRATION_TIME_SLICED",
+}
+
+# Conditioning of set_remote_temperature readings
+CONF_REMOTE_TEMPERATURE_FILTER = "remote_temperature_filter"
+CONF_SMOOTHING = "smoothing"
+CONF_WINDOW_SIZE = "window_size"
+CONF_ALPHA = "alpha"
+CONF_OUTLIER_THRESHOLD = "outlier_threshold"
+CONF_QUANTIZATION = "quantization"
+
+# Several remote sensors in the room, fused before conditioning
+CONF_REMOTE_TEMPERATURE_SENSORS = "remote_temperature_sensors"
+CONF_WEIGHT = "weight"
+CONF_MAX_AGE = "max_age"
+MAX_REMOTE_TEMPERATURE_SENSORS = 4
+RemoteTemperatureSmoothing = cg.global_ns.enum("RemoteTemperatureSmoothing", is_class=True)
+REMOTE_TEMPERATURE_SMOOTHING = {
+    "none": RemoteTemperatureSmoothing.NONE,
+    "median": RemoteTemperatureSmoothing.MEDIAN,
+    "ema": RemoteTemperatureSmoothing.EMA,
+}
+
+# Direct multizone negotiation between heads
+CONF_PEER_LINK = "peer_link"
+CONF_GROUP = "group"
+CONF_MULTICAST_ADDRESS = "multicast_address"
+
+# Back off polling while the unit is idle
+CONF_ADAPTIVE_POLLING = "adaptive_polling"
+CONF_MAX_INTERVAL = "max_interval"
+CONF_EFFECTIVE_POLL_INTERVAL = "effective_poll_interval"
+
+# Connection to the unit
+CONF_FIRST_SETTINGS_TIME = "first_settings_time"
+CONF_RECONNECTS = "reconnects"
+
+# Anti short cycling in managed dual point mode
+CONF_MODE_ARBITER = "mode_arbiter"
+CONF_DEADBAND = "deadband"
+CONF_MIN_RUN_TIME = "min_run_time"
+CONF_MIN_OFF_TIME = "min_off_time"
+CONF_SWITCH_COOLDOWN = "switch_cooldown"
+
+# Diagnostic sensors for the time spent in each hot path phase
+CONF_TIMING_SENSORS = "timing_sensors"
+TimingPhase = cg.global_ns.enum("TimingPhase")
+TIMING_PHASES = {
+    "update": TimingPhase.TIMING_UPDATE,
+    "sync": TimingPhase.TIMING_SYNC,
+    "write": TimingPhase.TIMING_WRITE,
+    "deadlines": TimingPhase.TIMING_DEADLINES,
+    "control": TimingPhase.TIMING_CONTROL,
+    "settings_callback": TimingPhase.TIMING_SETTINGS_CALLBACK,
+    "status_callback": TimingPhase.TIMING_STATUS_CALLBACK,
+}
+
+# Compressor runtime and energy totals, persisted across reboots
+CONF_RUNTIME_SENSORS = "runtime_sensors"
+RuntimeCounter = cg.global_ns.enum("RuntimeCounter")
+RUNTIME_COUNTERS = {
+    "compressor": RuntimeCounter.RUNTIME_COMPRESSOR,
+    "compressor_starts": RuntimeCounter.RUNTIME_COMPRESSOR_STARTS,
+    "frequency_hours": RuntimeCounter.RUNTIME_FREQUENCY_HOURS,
+    "heat": RuntimeCounter.RUNTIME_HEAT,
+    "cool": RuntimeCounter.RUNTIME_COOL,
+    "heat_cool": RuntimeCounter.RUNTIME_HEAT_COOL,
+    "dry": RuntimeCounter.RUNTIME_DRY,
+    "fan_only": RuntimeCounter.RUNTIME_FAN_ONLY,
+}
+
+CONF_EVENT_DRIVEN_RX = "event_driven_rx"
+CONF_PUBLISH_TEMPERATURE_THRESHOLD = "publish_temperature_threshold"
+CONF_MIN_PUBLISH_INTERVAL = "min_publish_interval"
 
 MitsubishiHeatPump = cg.global_ns.class_(
     "MitsubishiHeatPump", climate.Climate, cg.PollingComponent
@@ -67,6 +161,38 @@ CONFIG_SCHEMA = climate.CLIMATE_SCHEMA.extend(
     {cv.GenerateID(CONF_ID): cv.declare_id(MitsubishiACSelect)}
 )
 
+TIMING_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement="µs",
+    icon="mdi:timer-outline",
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+def runtime_sensor_schema(counter):
+    if counter == "compressor_starts":
+        return sensor.sensor_schema(
+            icon="mdi:counter",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        )
+    if counter == "frequency_hours":
+        return sensor.sensor_schema(
+            unit_of_measurement="Hz h",
+            icon="mdi:sine-wave",
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        )
+    return sensor.sensor_schema(
+        unit_of_measurement="h",
+        icon="mdi:timer-cog-outline",
+        accuracy_decimals=2,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
 CONFIG_SCHEMA = climate.CLIMATE_SCHEMA.extend(
     {
         cv.GenerateID(): cv.declare_id(MitsubishiHeatPump),
@@ -75,8 +201,122 @@ CONFIG_SCHEMA = climate.CLIMATE_SCHEMA.extend(
         cv.Optional(CONF_REMOTE_OPERATING_TIMEOUT): cv.positive_int,
         cv.Optional(CONF_REMOTE_IDLE_TIMEOUT): cv.positive_int,
         cv.Optional(CONF_REMOTE_PING_TIMEOUT): cv.positive_int,
+        cv.Optional(CONF_ZONE_EXPIRY): cv.positive_int,
+        cv.Optional(CONF_ZONE_WEIGHT, default=1.0): cv.float_range(min=0, max=100),
+        # Strategy deciding between heating and cooling across zones. Being
+        # compiled in, it applies to every heatpump on the node.
+        cv.Optional(CONF_ARBITRATION, default="max_delta"): cv.one_of(
+            *ARBITRATION_DEFINES, lower=True
+        ),
+        # Longest time one side is served while the other waits, for
+        # time_sliced arbitration.
+        cv.Optional(CONF_SLICE, default="30min"): cv.All(
+            cv.positive_time_period_minutes, cv.Range(min=cv.TimePeriod(minutes=1))
+        ),
+        # Smooth, reject outliers from and quantize set_remote_temperature
+        # readings, only writing to the unit when the result changes.
+        cv.Optional(CONF_REMOTE_TEMPERATURE_FILTER, default={}): cv.Schema(
+            {
+                cv.Optional(CONF_SMOOTHING, default="none"): cv.enum(
+                    REMOTE_TEMPERATURE_SMOOTHING, lower=True
+                ),
+                cv.Optional(CONF_WINDOW_SIZE, default=5): cv.int_range(min=1, max=9),
+                cv.Optional(CONF_ALPHA, default=0.3): cv.float_range(
+                    min=0, max=1, min_included=False
+                ),
+                cv.Optional(CONF_OUTLIER_THRESHOLD, default=0): cv.positive_float,
+                cv.Optional(CONF_QUANTIZATION, default=0.5): cv.positive_float,
+            }
+        ),
+        # Follow up to four sensors in the room as the remote temperature.
+        # Readings further than 2C from the others are left out and the rest
+        # are averaged by weight.
+        cv.Optional(CONF_REMOTE_TEMPERATURE_SENSORS): cv.All(
+            cv.ensure_list(
+                cv.Schema(
+                    {
+                        cv.Required(CONF_SENSOR): cv.use_id(sensor.Sensor),
+                        cv.Optional(CONF_WEIGHT, default=1.0): cv.positive_float,
+                        # Drop the sensor if it doesn't report for this long,
+                        # 0 keeps its last reading.
+                        cv.Optional(
+                            CONF_MAX_AGE, default="10min"
+                        ): cv.positive_time_period_milliseconds,
+                    }
+                )
+            ),
+            cv.Length(max=MAX_REMOTE_TEMPERATURE_SENSORS),
+        ),
+        # Exchange dual point state with the other heads on the same
+        # multisplit over UDP multicast.
+        cv.Optional(CONF_PEER_LINK): cv.Schema(
+            {
+                cv.Required(CONF_GROUP): cv.string_strict,
+                cv.Optional(
+                    CONF_MULTICAST_ADDRESS, default="239.255.77.105"
+                ): cv.ipv4,
+                cv.Optional(CONF_PORT, default=48105): cv.port,
+            }
+        ),
+        # Poll at update_interval after activity, backing off toward
+        # max_interval while idle. Also bounded by the HeatPump library's
+        # reconnect limit below.
+        cv.Optional(CONF_ADAPTIVE_POLLING): cv.Schema(
+            {
+                cv.Optional(CONF_MAX_INTERVAL, default="8s"): cv.All(
+                    cv.positive_time_period_milliseconds,
+                    cv.Range(max=cv.TimePeriod(milliseconds=9000)),
+                ),
+            }
+        ),
+        cv.Optional(CONF_EFFECTIVE_POLL_INTERVAL): sensor.sensor_schema(
+            unit_of_measurement="ms",
+            icon="mdi:timer-sync-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Time from boot until the unit first reported its settings, and the
+        # number of times the connection was re-established since.
+        cv.Optional(CONF_FIRST_SETTINGS_TIME): sensor.sensor_schema(
+            unit_of_measurement="ms",
+            icon="mdi:timer-check-outline",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_RECONNECTS): sensor.sensor_schema(
+            icon="mdi:lan-connect",
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # Limit how often managed dual point mode switches between HEAT and
+        # COOL.
+        cv.Optional(CONF_MODE_ARBITER, default={}): cv.Schema(
+            {
+                cv.Optional(CONF_DEADBAND, default=0.5): cv.positive_float,
+                cv.Optional(
+                    CONF_MIN_RUN_TIME, default="5min"
+                ): cv.positive_time_period_milliseconds,
+                cv.Optional(
+                    CONF_MIN_OFF_TIME, default="3min"
+                ): cv.positive_time_period_milliseconds,
+                cv.Optional(
+                    CONF_SWITCH_COOLDOWN, default="10min"
+                ): cv.positive_time_period_milliseconds,
+            }
+        ),
         cv.Optional(CONF_RX_PIN): cv.positive_int,
         cv.Optional(CONF_TX_PIN): cv.positive_int,
+        # Process responses from the heatpump as soon as they arrive instead
+        # of on the next poll.
+        cv.Optional(CONF_EVENT_DRIVEN_RX, default=False): cv.boolean,
+        # Limit how often current temperature changes are published.
+        cv.Optional(CONF_PUBLISH_TEMPERATURE_THRESHOLD, default=0.1): cv.positive_float,
+        cv.Optional(
+            CONF_MIN_PUBLISH_INTERVAL, default="0s"
+        ): cv.positive_time_period_milliseconds,
         # If polling interval is greater than 9 seconds, the HeatPump library
         # reconnects, but doesn't then follow up with our data request.
         cv.Optional(CONF_UPDATE_INTERVAL, default="500ms"): cv.All(
@@ -85,6 +325,17 @@ CONFIG_SCHEMA = climate.CLIMATE_SCHEMA.extend(
        # Add selects for vertical and horizontal vane positions
        cv.Optional(CONF_HORIZONTAL_SWING_SELECT): SELECT_SCHEMA,
        cv.Optional(CONF_VERTICAL_SWING_SELECT): SELECT_SCHEMA,
+        # Slowest call of each hot path phase over the last minute.
+        cv.Optional(CONF_TIMING_SENSORS): cv.Schema(
+            {cv.Optional(phase): TIMING_SENSOR_SCHEMA for phase in TIMING_PHASES}
+        ),
+        # Compressor runtime, starts, frequency hours and time per mode.
+        cv.Optional(CONF_RUNTIME_SENSORS): cv.Schema(
+            {
+                cv.Optional(counter): runtime_sensor_schema(counter)
+                for counter in RUNTIME_COUNTERS
+            }
+        ),
         # Optionally override the supported ClimateTraits.
         cv.Optional(CONF_SUPPORTS, default={}): cv.Schema(
             {
@@ -100,9 +351,46 @@ CONFIG_SCHEMA = climate.CLIMATE_SCHEMA.extend(
 ).extend(cv.COMPONENT_SCHEMA)
 
 
+def heatpump_configs():
+    return [
+        conf
+        for conf in fv.full_config.get().get("climate", [])
+        if conf.get(CONF_PLATFORM) == "mitsubishi_heatpump"
+    ]
+
+
+def validate_unique_uart(config):
+    # Several heatpumps can be driven from one node, but each needs its own
+    # UART.
+    uarts = [conf[CONF_HARDWARE_UART] for conf in heatpump_configs()]
+    if uarts.count(config[CONF_HARDWARE_UART]) > 1:
+        raise cv.Invalid(
+            f"{config[CONF_HARDWARE_UART]} is used by more than one mitsubishi_heatpump",
+            path=[CONF_HARDWARE_UART],
+        )
+    return config
+
+
+def validate_consistent_arbitration(config):
+    # The arbitration strategy and its slice are compiled in through defines,
+    # so every heatpump on the node has to agree on them.
+    for key in (CONF_ARBITRATION, CONF_SLICE):
+        for conf in heatpump_configs():
+            if conf[key] != config[key]:
+                raise cv.Invalid(
+                    f"Every mitsubishi_heatpump on a node must use the same {key}",
+                    path=[key],
+                )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = cv.All(validate_unique_uart, validate_consistent_arbitration)
+
+
 @coroutine
 def to_code(config):
-    serial = HARDWARE_UART_TO_SERIAL[PLATFORM_ESP8266][config[CONF_HARDWARE_UART]]
+    platform = PLATFORM_ESP32 if CORE.is_esp32 else PLATFORM_ESP8266
+    serial = HARDWARE_UART_TO_SERIAL[platform][config[CONF_HARDWARE_UART]]
     var = cg.new_Pvariable(config[CONF_ID], cg.RawExpression(f"&{serial}"))
 
     if CONF_BAUD_RATE in config:
@@ -114,6 +402,14 @@ def to_code(config):
     if CONF_TX_PIN in config:
         cg.add(var.set_tx_pin(config[CONF_TX_PIN]))
 
+    cg.add(var.set_event_driven_rx(config[CONF_EVENT_DRIVEN_RX]))
+    cg.add(var.set_publish_temperature_threshold(
+        config[CONF_PUBLISH_TEMPERATURE_THRESHOLD]
+    ))
+    cg.add(var.set_min_publish_interval(
+        config[CONF_MIN_PUBLISH_INTERVAL].total_milliseconds
+    ))
+
     if CONF_REMOTE_OPERATING_TIMEOUT in config:
         cg.add(var.set_remote_operating_timeout_minutes(config[CONF_REMOTE_OPERATING_TIMEOUT]))
 
@@ -123,6 +419,64 @@ def to_code(config):
     if CONF_REMOTE_PING_TIMEOUT in config:
         cg.add(var.set_remote_ping_timeout_minutes(config[CONF_REMOTE_PING_TIMEOUT]))
 
+    conf = config[CONF_REMOTE_TEMPERATURE_FILTER]
+    cg.add(var.set_remote_temperature_filter(
+        conf[CONF_SMOOTHING],
+        conf[CONF_WINDOW_SIZE],
+        conf[CONF_ALPHA],
+        conf[CONF_OUTLIER_THRESHOLD],
+        conf[CONF_QUANTIZATION],
+    ))
+
+    for conf in config.get(CONF_REMOTE_TEMPERATURE_SENSORS, []):
+        remote_sensor = yield cg.get_variable(conf[CONF_SENSOR])
+        cg.add(var.add_remote_temperature_sensor(
+            remote_sensor,
+            conf[CONF_WEIGHT],
+            conf[CONF_MAX_AGE].total_milliseconds,
+        ))
+
+    cg.add(var.set_zone_weight(config[CONF_ZONE_WEIGHT]))
+    arbitration_define = ARBITRATION_DEFINES[config[CONF_ARBITRATION]]
+    if arbitration_define is not None:
+        cg.add_define(arbitration_define)
+    cg.add_define(
+        "ESPMHP_ARBITRATION_SLICE_MINUTES", int(config[CONF_SLICE].total_minutes)
+    )
+
+    if CONF_ZONE_EXPIRY in config:
+        cg.add(var.set_zone_expiry_minutes(config[CONF_ZONE_EXPIRY]))
+
+    if CONF_ADAPTIVE_POLLING in config:
+        cg.add(var.set_adaptive_polling(
+            config[CONF_ADAPTIVE_POLLING][CONF_MAX_INTERVAL].total_milliseconds
+        ))
+
+    if CONF_EFFECTIVE_POLL_INTERVAL in config:
+        poll_interval_sensor = yield sensor.new_sensor(config[CONF_EFFECTIVE_POLL_INTERVAL])
+        cg.add(var.set_effective_poll_interval_sensor(poll_interval_sensor))
+
+    if CONF_FIRST_SETTINGS_TIME in config:
+        first_settings_sensor = yield sensor.new_sensor(config[CONF_FIRST_SETTINGS_TIME])
+        cg.add(var.set_first_settings_time_sensor(first_settings_sensor))
+
+    if CONF_RECONNECTS in config:
+        reconnects_sensor = yield sensor.new_sensor(config[CONF_RECONNECTS])
+        cg.add(var.set_reconnects_sensor(reconnects_sensor))
+
+    conf = config[CONF_MODE_ARBITER]
+    cg.add(var.set_mode_arbiter(
+        conf[CONF_DEADBAND],
+        conf[CONF_MIN_RUN_TIME].total_milliseconds,
+        conf[CONF_MIN_OFF_TIME].total_milliseconds,
+        conf[CONF_SWITCH_COOLDOWN].total_milliseconds,
+    ))
+
+    if CONF_PEER_LINK in config:
+        conf = config[CONF_PEER_LINK]
+        octets = [int(octet) for octet in str(conf[CONF_MULTICAST_ADDRESS]).split(".")]
+        cg.add(var.set_peer_link(conf[CONF_GROUP], *octets, conf[CONF_PORT]))
+
     supports = config[CONF_SUPPORTS]
     traits = var.config_traits()
 
@@ -151,6 +505,14 @@ def to_code(config):
         yield cg.register_component(swing_select, conf)
         cg.add(var.set_vertical_vane_select(swing_select))
 
+    for phase, conf in config.get(CONF_TIMING_SENSORS, {}).items():
+        timing_sensor = yield sensor.new_sensor(conf)
+        cg.add(var.set_timing_sensor(TIMING_PHASES[phase], timing_sensor))
+
+    for counter, conf in config.get(CONF_RUNTIME_SENSORS, {}).items():
+        runtime_sensor = yield sensor.new_sensor(conf)
+        cg.add(var.set_runtime_sensor(RUNTIME_COUNTERS[counter], runtime_sensor))
+
     yield cg.register_component(var, config)
     yield climate.register_climate(var, config)
     cg.add_library(
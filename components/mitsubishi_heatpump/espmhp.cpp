@@ -41,10 +41,6 @@ MitsubishiHeatPump::MitsubishiHeatPump(
     this->traits_.set_visual_min_temperature(ESPMHP_MIN_TEMPERATURE);
     this->traits_.set_visual_max_temperature(ESPMHP_MAX_TEMPERATURE);
     this->traits_.set_visual_temperature_step(ESPMHP_TEMPERATURE_STEP);
-
-    // Assume a successful connection was made to the ESPHome controller on
-    // launch.
-    this->ping();
 }
 
 void MitsubishiHeatPump::check_logger_conflict_() {
@@ -66,15 +62,170 @@ void MitsubishiHeatPump::banner() {
 void MitsubishiHeatPump::update() {
     // This will be called every "update_interval" milliseconds.
     //this->dump_config();
-    this->hp->sync();
-    this->hp->updateIfChangesPending();
+    ScopedTiming update_timing(this->timings_, TIMING_UPDATE);
+
+    if (this->poller_.tick(millis())) {
+        this->sync_requested_ = true;
+    }
+    if (this->sync_requested_ || this->hp->hasChangesPending()) {
+        this->serial_scheduler_.request(this->serial_link_, millis());
+    }
+    this->service_serial_();
 
 #ifndef USE_CALLBACKS
-    this->hpSettingsChanged();
-    heatpumpStatus currentStatus = hp->getStatus();
-    this->hpStatusChanged(currentStatus);
+    if (this->connection_.isEstablished()) {
+        this->hpSettingsChanged();
+        heatpumpStatus currentStatus = hp->getStatus();
+        this->hpStatusChanged(currentStatus);
+    }
 #endif
-    this->enforce_remote_temperature_sensor_timeout();
+    if (this->connection_.isEstablished()) {
+        // The status callback only fires on changes, keep crediting the
+        // current state in between.
+        heatpumpStatus status = this->hp->getStatus();
+        this->runtime_.onStatus(
+            millis(), this->mode, status.operating, status.compressorFrequency);
+    } else {
+        this->runtime_.onLinkLost();
+    }
+    {
+        ScopedTiming timing(this->timings_, TIMING_DEADLINES);
+        this->deadlines_.runExpired(millis());
+    }
+    bool heat_cool = this->mode == climate::CLIMATE_MODE_HEAT_COOL;
+    if (this->peer_link_.broadcast(
+            heat_cool,
+            this->target_temperature_low,
+            this->target_temperature_high,
+            this->current_temperature,
+            millis())) {
+        // Heads ignore their own broadcasts, so add this head's zone here.
+        this->zone_consistency_controller_.zoneUpdate(
+            this->peer_link_.getSender(),
+            heat_cool,
+            this->target_temperature_low,
+            this->target_temperature_high,
+            this->current_temperature,
+            this->zone_weight_);
+        this->schedule_zone_expiry_deadline_();
+    }
+
+    if (this->publish_gate_.hasPendingPublish(millis())) {
+        this->publish_state_now_();
+    }
+    this->preferences_.loop(millis());
+    this->runtime_.loop(millis());
+
+    if (millis() - this->last_statistics_log_ > ESPMHP_STATISTICS_LOG_INTERVAL) {
+        this->last_statistics_log_ = millis();
+        this->link_statistics_.log(TAG);
+        this->log_statistics();
+        this->publish_timing_sensors_();
+        this->publish_connection_sensors_();
+        this->publish_runtime_sensors_();
+
+        uint32_t poll_interval = this->poller_.takeEffectiveInterval(millis());
+        ESP_LOGD(TAG, "Polling: one sync every %u ms (currently %u ms), %u of %u ticks skipped",
+            poll_interval, this->poller_.getInterval(), this->poller_.getSkipped(),
+            this->poller_.getSkipped() + this->poller_.getSyncs());
+        if (this->effective_poll_interval_sensor_ != nullptr) {
+            this->effective_poll_interval_sensor_->publish_state(poll_interval);
+        }
+    }
+}
+
+void MitsubishiHeatPump::on_shutdown() {
+    this->preferences_.flush();
+    this->runtime_.flush();
+}
+
+void MitsubishiHeatPump::loop() {
+    this->peer_link_.loop();
+
+    if (this->hp == nullptr) {
+        return;
+    }
+
+    if (this->connection_.shouldConnect(millis())) {
+        this->serial_scheduler_.request(this->serial_link_, millis());
+    } else if (this->event_driven_rx_ && this->rx_packet_ready_()) {
+        this->sync_requested_ = true;
+        this->serial_scheduler_.request(this->serial_link_, millis());
+    }
+
+    // Serial work that was waiting for its turn behind other heatpumps.
+    this->service_serial_();
+}
+
+bool MitsubishiHeatPump::rx_packet_ready_() {
+    // Requests are still issued from update(); here we only pick up the
+    // response as soon as it is complete instead of up to a poll later.
+    if (this->get_hw_serial_()->available() < ESPMHP_RX_PACKET_LENGTH) {
+        return false;
+    }
+
+    // The HeatPump library paces its own reads, don't spin on it every loop
+    // iteration while it waits for the packet interval to elapse.
+    uint32_t now = millis();
+    if (now - this->last_rx_drain_ < ESPMHP_RX_DRAIN_INTERVAL) {
+        return false;
+    }
+    this->last_rx_drain_ = now;
+    return true;
+}
+
+void MitsubishiHeatPump::service_serial_() {
+    if (!this->serial_scheduler_.acquire(this->serial_link_, millis())) {
+        return;
+    }
+
+    if (this->connection_.shouldConnect(millis())) {
+        ESP_LOGD(TAG, "Connecting to HeatPump, attempt %u", this->connection_.getAttempts() + 1);
+        bool connected = this->hp->connect(
+            this->get_hw_serial_(), this->baud_, this->rx_pin_, this->tx_pin_);
+        this->connection_.onConnectResult(connected, millis());
+        this->sync_requested_ = connected;
+        this->serial_scheduler_.release(millis());
+        return;
+    }
+    if (!this->connection_.canSync()) {
+        // Nothing to talk to until the next attempt, keep any pending write.
+        this->sync_requested_ = false;
+        this->serial_scheduler_.release(millis());
+        return;
+    }
+
+    if (this->sync_requested_) {
+        this->sync_requested_ = false;
+        {
+            ScopedTiming timing(this->timings_, TIMING_SYNC);
+            this->hp->sync();
+        }
+        this->connection_.onSync(
+            this->hp->isConnected(), this->hp->getSettings().isValid(), millis());
+    }
+    if (!this->connection_.isEstablished()) {
+        // Hold writes until the unit's settings are known.
+        this->serial_scheduler_.release(millis());
+        return;
+    }
+
+    WriteResult write_result;
+    {
+        ScopedTiming timing(this->timings_, TIMING_WRITE);
+        write_result = this->hp->updateIfChangesPending();
+    }
+    if (write_result != WriteResult::WRITE_NONE) {
+        // A skipped write means the unit already has the requested settings.
+        this->link_statistics_.onCommandWritten(
+            millis(), write_result != WriteResult::WRITE_FAILED);
+    }
+
+    this->serial_scheduler_.release(millis());
+}
+
+void MitsubishiHeatPump::set_event_driven_rx(bool event_driven_rx) {
+    this->event_driven_rx_ = event_driven_rx;
 }
 
 void MitsubishiHeatPump::set_baud_rate(int baud) {
@@ -113,24 +264,45 @@ climate::ClimateTraits& MitsubishiHeatPump::config_traits() {
     return traits_;
 }
 
-void MitsubishiHeatPump::update_swing_horizontal(const std::string &swing) {
-    this->horizontal_swing_state_ = swing;
+void MitsubishiHeatPump::update_swing_horizontal(HeatpumpWideVaneSetting wide_vane) {
+    if (wide_vane == HeatpumpWideVaneSetting::UNKNOWN) {
+        return;
+    }
+    this->horizontal_swing_state_ = wide_vane;
 
+    const char* option = ESPMHP_HORIZONTAL_VANE_OPTIONS[static_cast<uint8_t>(wide_vane)];
     if (this->horizontal_vane_select_ != nullptr &&
-        this->horizontal_vane_select_->state != this->horizontal_swing_state_) {
-        this->horizontal_vane_select_->publish_state(
-            this->horizontal_swing_state_);  // Set current horizontal swing
-                                             // position
+        this->horizontal_vane_select_->state != option) {
+        this->horizontal_vane_select_->publish_state(option);  // Set current horizontal swing
+                                                               // position
     }
 }
 
-void MitsubishiHeatPump::update_swing_vertical(const std::string &swing) {
-    this->vertical_swing_state_ = swing;
+void MitsubishiHeatPump::update_swing_vertical(HeatpumpVaneSetting vane) {
+    if (vane == HeatpumpVaneSetting::UNKNOWN) {
+        return;
+    }
+    this->vertical_swing_state_ = vane;
 
+    const char* option = ESPMHP_VERTICAL_VANE_OPTIONS[static_cast<uint8_t>(vane)];
     if (this->vertical_vane_select_ != nullptr &&
-        this->vertical_vane_select_->state != this->vertical_swing_state_) {
-        this->vertical_vane_select_->publish_state(
-            this->vertical_swing_state_);  // Set current vertical swing position
+        this->vertical_vane_select_->state != option) {
+        this->vertical_vane_select_->publish_state(option);  // Set current vertical swing position
+    }
+}
+
+void MitsubishiHeatPump::set_timing_sensor(
+    TimingPhase phase, sensor::Sensor *timing_sensor) {
+    this->timing_sensors_[phase] = timing_sensor;
+}
+
+void MitsubishiHeatPump::publish_timing_sensors_() {
+    for (uint8_t i = 0; i < TIMING_PHASE_COUNT; i++) {
+        TimingPhase phase = static_cast<TimingPhase>(i);
+        uint32_t window_max = this->timings_[phase].takeWindowMax();
+        if (this->timing_sensors_[i] != nullptr) {
+            this->timing_sensors_[i]->publish_state(window_max);
+        }
     }
 }
 
@@ -139,8 +311,11 @@ void MitsubishiHeatPump::set_vertical_vane_select(
     this->vertical_vane_select_ = vertical_vane_select;
     this->vertical_vane_select_->add_on_state_callback(
         [this](const std::string &value, size_t index) {
-            if (value == this->vertical_swing_state_) return;
-            this->on_vertical_swing_change(value);
+            // Options are in HeatpumpVaneSetting order.
+            if (index >= static_cast<size_t>(HeatpumpVaneSetting::UNKNOWN)) return;
+            HeatpumpVaneSetting vane = static_cast<HeatpumpVaneSetting>(index);
+            if (vane == this->vertical_swing_state_) return;
+            this->on_vertical_swing_change(vane);
         });
 }
 
@@ -149,76 +324,25 @@ void MitsubishiHeatPump::set_horizontal_vane_select(
       this->horizontal_vane_select_ = horizontal_vane_select;
       this->horizontal_vane_select_->add_on_state_callback(
           [this](const std::string &value, size_t index) {
-              if (value == this->horizontal_swing_state_) return;
-              this->on_horizontal_swing_change(value);
+              // Options are in HeatpumpWideVaneSetting order.
+              if (index >= static_cast<size_t>(HeatpumpWideVaneSetting::UNKNOWN)) return;
+              HeatpumpWideVaneSetting wide_vane = static_cast<HeatpumpWideVaneSetting>(index);
+              if (wide_vane == this->horizontal_swing_state_) return;
+              this->on_horizontal_swing_change(wide_vane);
           });
 }
 
-void MitsubishiHeatPump::on_vertical_swing_change(const std::string &swing) {
-    ESP_LOGD(TAG, "Setting vertical swing position");
-    bool updated = false;
-
-    if (swing == "swing") {
-        hp->setVaneSetting("SWING");
-        updated = true;
-    } else if (swing == "auto") {
-        hp->setVaneSetting("AUTO");
-        updated = true;
-    } else if (swing == "up") {
-        hp->setVaneSetting("1");
-        updated = true;
-    } else if (swing == "up_center") {
-        hp->setVaneSetting("2");
-        updated = true;
-    } else if (swing == "center") {
-        hp->setVaneSetting("3");
-        updated = true;
-    } else if (swing == "down_center") {
-        hp->setVaneSetting("4");
-        updated = true;
-    } else if (swing == "down") {
-        hp->setVaneSetting("5");
-        updated = true;
-    } else {
-        ESP_LOGW(TAG, "Invalid vertical vane position %s", swing);
-    }
-
-    ESP_LOGD(TAG, "Vertical vane - Was HeatPump updated? %s", YESNO(updated));
+void MitsubishiHeatPump::on_vertical_swing_change(HeatpumpVaneSetting vane) {
+    ESP_LOGD(TAG, "Setting vertical swing position to %s", toString(vane));
+    hp->setVaneSetting(vane);
 
     // and the heat pump:
     hp->update();
 }
 
-void MitsubishiHeatPump::on_horizontal_swing_change(const std::string &swing) {
-    ESP_LOGD(TAG, "Setting horizontal swing position");
-    bool updated = false;
-
-    if (swing == "swing") {
-        hp->setWideVaneSetting("SWING");
-        updated = true;
-    } else if (swing == "auto") {
-        hp->setWideVaneSetting("<>");
-        updated = true;
-    } else if (swing == "left") {
-        hp->setWideVaneSetting("<<");
-        updated = true;
-    } else if (swing == "left_center") {
-        hp->setWideVaneSetting("<");
-        updated = true;
-    } else if (swing == "center") {
-        hp->setWideVaneSetting("|");
-        updated = true;
-    } else if (swing == "right_center") {
-        hp->setWideVaneSetting(">");
-        updated = true;
-    } else if (swing == "right") {
-        hp->setWideVaneSetting(">>");
-        updated = true;
-    } else {
-        ESP_LOGW(TAG, "Invalid horizontal vane position %s", swing);
-    }
-
-    ESP_LOGD(TAG, "Horizontal vane - Was HeatPump updated? %s", YESNO(updated));
+void MitsubishiHeatPump::on_horizontal_swing_change(HeatpumpWideVaneSetting wide_vane) {
+    ESP_LOGD(TAG, "Setting horizontal swing position to %s", toString(wide_vane));
+    hp->setWideVaneSetting(wide_vane);
 
     // and the heat pump:
     hp->update();
@@ -231,6 +355,7 @@ void MitsubishiHeatPump::on_horizontal_swing_change(const std::string &swing) {
  */
 void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
     ESP_LOGV(TAG, "Control called.");
+    ScopedTiming control_timing(this->timings_, TIMING_CONTROL);
 
     bool updated = false;
     bool has_mode = call.get_mode().has_value();
@@ -240,7 +365,7 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
         this->mode = *call.get_mode();
     }
 
-    if (last_remote_temperature_sensor_update_.has_value()) {
+    if (this->remote_temperature_active_) {
         // Some remote temperature sensors will only issue updates when a change
         // in temperature occurs. 
 
@@ -253,16 +378,16 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
         // This change ensures that if the user changes the machine setpoint,
         // the remote sensor has an opportunity to issue an update to reflect
         // the new change in temperature.
-        last_remote_temperature_sensor_update_ =
-            std::chrono::steady_clock::now();
+        this->last_remote_temperature_sensor_update_ = millis();
+        this->schedule_remote_temperature_deadline_();
     }
 
     managed_mode = false;
 
     switch (this->mode) {
         case climate::CLIMATE_MODE_COOL:
-            hp->setModeSetting("COOL");
-            hp->setPowerSetting("ON");
+            hp->setModeSetting(HeatpumpModeSetting::COOL);
+            hp->setPowerSetting(HeatpumpPowerSetting::ON);
 
             if (has_mode){
                 if (cool_setpoint.has_value() && 
@@ -276,8 +401,8 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
             }
             break;
         case climate::CLIMATE_MODE_HEAT:
-            hp->setModeSetting("HEAT");
-            hp->setPowerSetting("ON");
+            hp->setModeSetting(HeatpumpModeSetting::HEAT);
+            hp->setPowerSetting(HeatpumpPowerSetting::ON);
             if (has_mode){
                 if (heat_setpoint.has_value() &&
                     !has_temp_low &&
@@ -290,16 +415,16 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
             }
             break;
         case climate::CLIMATE_MODE_DRY:
-            hp->setModeSetting("DRY");
-            hp->setPowerSetting("ON");
+            hp->setModeSetting(HeatpumpModeSetting::DRY);
+            hp->setPowerSetting(HeatpumpPowerSetting::ON);
             if (has_mode){
                 this->action = climate::CLIMATE_ACTION_DRYING;
                 updated = true;
             }
             break;
         case climate::CLIMATE_MODE_HEAT_COOL:
-            hp->setModeSetting("DUAL_POINT");
-            hp->setPowerSetting("ON");
+            hp->setModeSetting(HeatpumpModeSetting::DUAL_POINT);
+            hp->setPowerSetting(HeatpumpPowerSetting::ON);
             managed_mode = true;
             if (has_mode){
                 if (heat_setpoint.has_value() &&
@@ -324,8 +449,8 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
             updated = true;
             break;
         case climate::CLIMATE_MODE_FAN_ONLY:
-            hp->setModeSetting("FAN");
-            hp->setPowerSetting("ON");
+            hp->setModeSetting(HeatpumpModeSetting::FAN);
+            hp->setPowerSetting(HeatpumpPowerSetting::ON);
             if (has_mode){
                 this->action = climate::CLIMATE_ACTION_FAN;
                 updated = true;
@@ -334,7 +459,7 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
         case climate::CLIMATE_MODE_OFF:
         default:
             if (has_mode){
-                hp->setPowerSetting("OFF");
+                hp->setPowerSetting(HeatpumpPowerSetting::OFF);
                 this->action = climate::CLIMATE_ACTION_OFF;
                 updated = true;
             }
@@ -350,7 +475,7 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
         this->target_temperature_low = *call.get_target_temperature_low();
 
         this->heat_setpoint = this->target_temperature_low;
-        save(this->target_temperature_low, heat_storage);
+        this->preferences_.setHeatSetpoint(this->target_temperature_low);
 
         updated = true;
     }
@@ -364,12 +489,12 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
         this->target_temperature_high = *call.get_target_temperature_high();
 
         this->cool_setpoint = this->target_temperature_high;
-        save(this->target_temperature_high, cool_storage);
+        this->preferences_.setCoolSetpoint(this->target_temperature_high);
 
         updated = true;
     }
 
-    save(managed_mode, managed_mode_storage);
+    this->preferences_.setManagedMode(managed_mode.value_or(false));
 
     //const char* FAN_MAP[6]         = {"AUTO", "QUIET", "1", "2", "3", "4"};
     if (call.get_fan_mode().has_value()) {
@@ -377,33 +502,33 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
         this->fan_mode = *call.get_fan_mode();
         switch(*call.get_fan_mode()) {
             case climate::CLIMATE_FAN_OFF:
-                hp->setPowerSetting("OFF");
+                hp->setPowerSetting(HeatpumpPowerSetting::OFF);
                 updated = true;
                 break;
             case climate::CLIMATE_FAN_DIFFUSE:
-                hp->setFanSpeed("QUIET");
+                hp->setFanSpeed(HeatpumpFanSetting::QUIET);
                 updated = true;
                 break;
             case climate::CLIMATE_FAN_LOW:
-                hp->setFanSpeed("1");
+                hp->setFanSpeed(HeatpumpFanSetting::SPEED_1);
                 updated = true;
                 break;
             case climate::CLIMATE_FAN_MEDIUM:
-                hp->setFanSpeed("2");
+                hp->setFanSpeed(HeatpumpFanSetting::SPEED_2);
                 updated = true;
                 break;
             case climate::CLIMATE_FAN_MIDDLE:
-                hp->setFanSpeed("3");
+                hp->setFanSpeed(HeatpumpFanSetting::SPEED_3);
                 updated = true;
                 break;
             case climate::CLIMATE_FAN_HIGH:
-                hp->setFanSpeed("4");
+                hp->setFanSpeed(HeatpumpFanSetting::SPEED_4);
                 updated = true;
                 break;
             case climate::CLIMATE_FAN_ON:
             case climate::CLIMATE_FAN_AUTO:
             default:
-                hp->setFanSpeed("AUTO");
+                hp->setFanSpeed(HeatpumpFanSetting::AUTO);
                 updated = true;
                 break;
         }
@@ -417,23 +542,23 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
         this->swing_mode = *call.get_swing_mode();
         switch(*call.get_swing_mode()) {
             case climate::CLIMATE_SWING_OFF:
-                hp->setVaneSetting("AUTO");
-                hp->setWideVaneSetting("|");
+                hp->setVaneSetting(HeatpumpVaneSetting::AUTO);
+                hp->setWideVaneSetting(HeatpumpWideVaneSetting::CENTER);
                 updated = true;
                 break;
             case climate::CLIMATE_SWING_VERTICAL:
-                hp->setVaneSetting("SWING");
-                hp->setWideVaneSetting("|");
+                hp->setVaneSetting(HeatpumpVaneSetting::SWING);
+                hp->setWideVaneSetting(HeatpumpWideVaneSetting::CENTER);
                 updated = true;
                 break;
             case climate::CLIMATE_SWING_HORIZONTAL:
-                hp->setVaneSetting("3");
-                hp->setWideVaneSetting("SWING");
+                hp->setVaneSetting(HeatpumpVaneSetting::POSITION_3);
+                hp->setWideVaneSetting(HeatpumpWideVaneSetting::SWING);
                 updated = true;
                 break;
             case climate::CLIMATE_SWING_BOTH:
-                hp->setVaneSetting("SWING");
-                hp->setWideVaneSetting("SWING");
+                hp->setVaneSetting(HeatpumpVaneSetting::SWING);
+                hp->setWideVaneSetting(HeatpumpWideVaneSetting::SWING);
                 updated = true;
                 break;
             default:
@@ -444,15 +569,18 @@ void MitsubishiHeatPump::control(const climate::ClimateCall &call) {
     ESP_LOGD(TAG, "control - Was HeatPump updated? %s", YESNO(updated));
 
     // send the update back to esphome:
-    this->publish_state();
+    this->publish_state_now_();
     // and the heat pump:
+    this->link_statistics_.onCommandQueued(millis());
+    this->poller_.onActivity();
     hp->update();
 }
 
 void MitsubishiHeatPump::hpSettingsChanged() {
+    this->poller_.onActivity();
     twoPointHeatPumpSettings currentSettings = hp->getSettings();
 
-    if (currentSettings.power == NULL) {
+    if (!currentSettings.isValid()) {
         /*
          * We should always get a valid pointer here once the HeatPump
          * component fully initializes. If HeatPump hasn't read the settings
@@ -460,8 +588,7 @@ void MitsubishiHeatPump::hpSettingsChanged() {
          * to punt on the update. Likely not an issue when run in callback
          * mode, but that isn't working right yet.
          */
-        ESP_LOGW(TAG, "Waiting for HeatPump to read the settings the first time.");
-        esphome::delay(10);
+        ESP_LOGD(TAG, "Waiting for HeatPump to read the settings the first time.");
         return;
     }
 
@@ -471,46 +598,50 @@ void MitsubishiHeatPump::hpSettingsChanged() {
      * const char* POWER_MAP[2]       = {"OFF", "ON"};
      * const char* MODE_MAP[5]        = {"HEAT", "DRY", "COOL", "FAN", "AUTO"};
      */
-    if (strcmp(currentSettings.power, "ON") == 0) {
-        if (strcmp(currentSettings.mode, "HEAT") == 0 || 
-            strcmp(currentSettings.mode, "COOL") == 0 ||
-            strcmp(currentSettings.mode, "DUAL_POINT") == 0) {
-            auto previousMode = this->mode;
-            if (strcmp(currentSettings.mode, "DUAL_POINT") == 0) {
-                this->mode = climate::CLIMATE_MODE_HEAT_COOL;
-            } else if (strcmp(currentSettings.mode, "HEAT") == 0) {
-                this->mode = climate::CLIMATE_MODE_HEAT;
-            } else {
-                this->mode = climate::CLIMATE_MODE_COOL;
-
-            }
+    if (currentSettings.power == HeatpumpPowerSetting::ON) {
+        switch (currentSettings.mode) {
+            case HeatpumpModeSetting::HEAT:
+            case HeatpumpModeSetting::COOL:
+            case HeatpumpModeSetting::DUAL_POINT: {
+                auto previousMode = this->mode;
+                if (currentSettings.mode == HeatpumpModeSetting::DUAL_POINT) {
+                    this->mode = climate::CLIMATE_MODE_HEAT_COOL;
+                } else if (currentSettings.mode == HeatpumpModeSetting::HEAT) {
+                    this->mode = climate::CLIMATE_MODE_HEAT;
+                } else {
+                    this->mode = climate::CLIMATE_MODE_COOL;
+                }
 
-            if (cool_setpoint != currentSettings.temperature_high && 
-                    currentSettings.temperature_high > 0) {
-                cool_setpoint = currentSettings.temperature_high;
-                save(currentSettings.temperature_high, cool_storage);
-            }
-            if (heat_setpoint != currentSettings.temperature_low && 
-                    currentSettings.temperature_low > 0) {
-                heat_setpoint = currentSettings.temperature_low;
-                save(currentSettings.temperature_low, heat_storage);
-            }
+                if (cool_setpoint != currentSettings.temperature_high && 
+                        currentSettings.temperature_high > 0) {
+                    cool_setpoint = currentSettings.temperature_high;
+                    this->preferences_.setCoolSetpoint(currentSettings.temperature_high);
+                }
+                if (heat_setpoint != currentSettings.temperature_low && 
+                        currentSettings.temperature_low > 0) {
+                    heat_setpoint = currentSettings.temperature_low;
+                    this->preferences_.setHeatSetpoint(currentSettings.temperature_low);
+                }
 
-            if (previousMode != this->mode) {
-                this->action = climate::CLIMATE_ACTION_IDLE;
+                if (previousMode != this->mode) {
+                    this->action = climate::CLIMATE_ACTION_IDLE;
+                }
+                break;
             }
-        } else if (strcmp(currentSettings.mode, "DRY") == 0) {
-            this->mode = climate::CLIMATE_MODE_DRY;
-            this->action = climate::CLIMATE_ACTION_DRYING;
-        } else if (strcmp(currentSettings.mode, "FAN") == 0) {
-            this->mode = climate::CLIMATE_MODE_FAN_ONLY;
-            this->action = climate::CLIMATE_ACTION_FAN;
-        } else {
-            ESP_LOGW(
-                    TAG,
-                    "Unknown climate mode value %s received from HeatPump",
-                    currentSettings.mode
-            );
+            case HeatpumpModeSetting::DRY:
+                this->mode = climate::CLIMATE_MODE_DRY;
+                this->action = climate::CLIMATE_ACTION_DRYING;
+                break;
+            case HeatpumpModeSetting::FAN:
+                this->mode = climate::CLIMATE_MODE_FAN_ONLY;
+                this->action = climate::CLIMATE_ACTION_FAN;
+                break;
+            default:
+                ESP_LOGW(
+                        TAG,
+                        "Unknown climate mode value %s received from HeatPump",
+                        toString(currentSettings.mode)
+                );
         }
     } else {
         this->mode = climate::CLIMATE_MODE_OFF;
@@ -524,70 +655,29 @@ void MitsubishiHeatPump::hpSettingsChanged() {
      *
      * const char* FAN_MAP[6]         = {"AUTO", "QUIET", "1", "2", "3", "4"};
      */
-    if (strcmp(currentSettings.fan, "QUIET") == 0) {
-        this->fan_mode = climate::CLIMATE_FAN_DIFFUSE;
-    } else if (strcmp(currentSettings.fan, "1") == 0) {
-            this->fan_mode = climate::CLIMATE_FAN_LOW;
-    } else if (strcmp(currentSettings.fan, "2") == 0) {
-            this->fan_mode = climate::CLIMATE_FAN_MEDIUM;
-    } else if (strcmp(currentSettings.fan, "3") == 0) {
-            this->fan_mode = climate::CLIMATE_FAN_MIDDLE;
-    } else if (strcmp(currentSettings.fan, "4") == 0) {
-            this->fan_mode = climate::CLIMATE_FAN_HIGH;
-    } else { //case "AUTO" or default:
-        this->fan_mode = climate::CLIMATE_FAN_AUTO;
-    }
+    this->fan_mode = ESPMHP_FAN_MODES[static_cast<uint8_t>(currentSettings.fan)];
     ESP_LOGI(TAG, "Fan mode is: %i", this->fan_mode.value_or(-1));
 
     /* ******** HANDLE MITSUBISHI VANE CHANGES ********
      * const char* VANE_MAP[7]        = {"AUTO", "1", "2", "3", "4", "5", "SWING"};
      */
-    if (strcmp(currentSettings.vane, "SWING") == 0 &&
-        strcmp(currentSettings.wideVane, "SWING") == 0) {
-        this->swing_mode = climate::CLIMATE_SWING_VERTICAL;
-    } else if (strcmp(currentSettings.vane, "SWING") == 0) {
+    bool vane_swing = currentSettings.vane == HeatpumpVaneSetting::SWING;
+    bool wide_vane_swing = currentSettings.wideVane == HeatpumpWideVaneSetting::SWING;
+    if (vane_swing) {
         this->swing_mode = climate::CLIMATE_SWING_VERTICAL;
-    } else if (strcmp(currentSettings.wideVane, "SWING") == 0) {
+    } else if (wide_vane_swing) {
         this->swing_mode = climate::CLIMATE_SWING_HORIZONTAL;
     } else {
         this->swing_mode = climate::CLIMATE_SWING_OFF;
     }
     ESP_LOGI(TAG, "Swing mode is: %i", this->swing_mode);
-    if (strcmp(currentSettings.vane, "SWING") == 0) {
-        this->update_swing_vertical("swing");
-    } else if (strcmp(currentSettings.vane, "AUTO") == 0) {
-        this->update_swing_vertical("auto");
-    } else if (strcmp(currentSettings.vane, "1") == 0) {
-        this->update_swing_vertical("up");
-    } else if (strcmp(currentSettings.vane, "2") == 0) {
-        this->update_swing_vertical("up_center");
-    } else if (strcmp(currentSettings.vane, "3") == 0) {
-        this->update_swing_vertical("center");
-    } else if (strcmp(currentSettings.vane, "4") == 0) {
-        this->update_swing_vertical("down_center");
-    } else if (strcmp(currentSettings.vane, "5") == 0) {
-        this->update_swing_vertical("down");
-    }
-
-    ESP_LOGI(TAG, "Vertical vane mode is: %s", currentSettings.vane);
-
-    if (strcmp(currentSettings.wideVane, "SWING") == 0) {
-        this->update_swing_horizontal("swing");
-    } else if (strcmp(currentSettings.wideVane, "<>") == 0) {
-        this->update_swing_horizontal("auto");
-    } else if (strcmp(currentSettings.wideVane, "<<") == 0) {
-        this->update_swing_horizontal("left");
-    } else if (strcmp(currentSettings.wideVane, "<") == 0) {
-        this->update_swing_horizontal("left_center");
-    } else if (strcmp(currentSettings.wideVane, "|") == 0) {
-        this->update_swing_horizontal("center");
-    } else if (strcmp(currentSettings.wideVane, ">") == 0) {
-        this->update_swing_horizontal("right_center");
-    } else if (strcmp(currentSettings.wideVane, ">>") == 0) {
-        this->update_swing_horizontal("right");
-    }
-
-    ESP_LOGI(TAG, "Horizontal vane mode is: %s", currentSettings.wideVane);
+
+    this->update_swing_vertical(currentSettings.vane);
+    ESP_LOGI(TAG, "Vertical vane mode is: %s", toString(currentSettings.vane));
+
+    this->update_swing_horizontal(currentSettings.wideVane);
+
+    ESP_LOGI(TAG, "Horizontal vane mode is: %s", toString(currentSettings.wideVane));
 
     /*
      * ******** HANDLE TARGET TEMPERATURE CHANGES ********
@@ -614,10 +704,17 @@ void MitsubishiHeatPump::hpSettingsChanged() {
 
     ESP_LOGI(TAG, "Target temps are: %f %f", this->target_temperature_low, this->target_temperature_high);
 
+    this->preferences_.setUnitState(PersistedUnitState{
+        this->mode,
+        this->fan_mode.value_or(climate::CLIMATE_FAN_AUTO),
+        this->swing_mode,
+        currentSettings.vane,
+        currentSettings.wideVane});
+
     /*
      * ******** Publish state back to ESPHome. ********
      */
-    this->publish_state();
+    this->publish_state_if_changed_();
 }
 
 /**
@@ -669,68 +766,280 @@ void MitsubishiHeatPump::hpStatusChanged(heatpumpStatus currentStatus) {
             this->action = climate::CLIMATE_ACTION_OFF;
     }
 
-    this->operating_ = currentStatus.operating;
+    this->runtime_.onStatus(
+        millis(), this->mode, currentStatus.operating, currentStatus.compressorFrequency);
+
+    if (this->operating_ != currentStatus.operating) {
+        this->operating_ = currentStatus.operating;
+        // The operating and idle timeouts may differ.
+        this->schedule_remote_temperature_deadline_();
+    }
+
+    this->publish_state_if_changed_();
+}
+
+PublishedClimateState MitsubishiHeatPump::published_state_() {
+    PublishedClimateState state;
+    state.mode = this->mode;
+    state.action = this->action;
+    state.fan_mode = this->fan_mode;
+    state.swing_mode = this->swing_mode;
+    state.current_temperature = this->current_temperature;
+    state.target_temperature_low = this->target_temperature_low;
+    state.target_temperature_high = this->target_temperature_high;
+    return state;
+}
+
+void MitsubishiHeatPump::publish_state_if_changed_() {
+    if (this->publish_gate_.shouldPublish(this->published_state_(), millis())) {
+        this->publish_state_now_();
+    }
+}
 
+void MitsubishiHeatPump::publish_state_now_() {
     this->publish_state();
+    this->publish_gate_.onPublished(this->published_state_(), millis());
+}
+
+void MitsubishiHeatPump::set_publish_temperature_threshold(float threshold) {
+    this->publish_gate_.setTemperatureThreshold(threshold);
+}
+
+void MitsubishiHeatPump::set_min_publish_interval(uint32_t interval_ms) {
+    this->publish_gate_.setMinPublishInterval(interval_ms);
 }
 
 void MitsubishiHeatPump::set_remote_temperature(float temp) {
     ESP_LOGD(TAG, "Setting remote temp: %.1f", temp);
-    if (temp > 0) {
-        last_remote_temperature_sensor_update_ = 
-            std::chrono::steady_clock::now();
+    if (temp <= 0) {
+        // Stop using every remote sensor, not just the unnamed one.
+        this->temperature_fusion_.reset();
+        this->deadlines_.cancel(DEADLINE_SENSOR_EXPIRY);
+        this->revert_to_internal_temperature_();
+        return;
+    }
+    this->report_remote_temperature_(0, temp);
+}
+
+void MitsubishiHeatPump::set_remote_temperature(const std::string& sensor, float temp) {
+    ESP_LOGD(TAG, "Setting remote temp from %s: %.1f", sensor.c_str(), temp);
+    this->report_remote_temperature_(ZoneTable::internId(sensor), temp);
+}
+
+void MitsubishiHeatPump::add_remote_temperature_sensor(
+            esphome::sensor::Sensor* sensor, float weight, uint32_t max_age_ms) {
+    uint32_t id = sensor->get_object_id_hash();
+    if (!this->temperature_fusion_.configure(id, weight, max_age_ms)) {
+        ESP_LOGW(TAG, "Too many remote temperature sensors, ignoring one");
+        return;
+    }
+    sensor->add_on_state_callback([this, id](float temp) {
+        this->report_remote_temperature_(id, temp);
+    });
+}
+
+void MitsubishiHeatPump::report_remote_temperature_(uint32_t sensor, float temp) {
+    if (std::isnan(temp) || temp <= 0) {
+        this->temperature_fusion_.drop(sensor);
     } else {
-        last_remote_temperature_sensor_update_.reset();
+        this->temperature_fusion_.report(sensor, temp, millis());
+    }
+    this->schedule_sensor_expiry_deadline_();
+    this->apply_fused_temperature_();
+}
+
+void MitsubishiHeatPump::revert_to_internal_temperature_() {
+    this->remote_temperature_active_ = false;
+    this->deadlines_.cancel(DEADLINE_REMOTE_TEMPERATURE);
+    this->remote_temperature_filter_.reset();
+    this->hp->setRemoteTemperature(0);
+}
+
+void MitsubishiHeatPump::apply_fused_temperature_() {
+    float temp;
+    if (!this->temperature_fusion_.fuse(&temp)) {
+        // The last remote sensor went away.
+        if (this->remote_temperature_active_) {
+            this->revert_to_internal_temperature_();
+        }
+        return;
+    }
+
+    float conditioned = temp;
+    RemoteTemperatureFilter::Result result =
+        this->remote_temperature_filter_.process(temp, &conditioned);
+    if (result == RemoteTemperatureFilter::REJECTED) {
+        ESP_LOGW(TAG, "Ignoring remote temp outlier: %.1f", temp);
+        return;
     }
 
-    this->hp->setRemoteTemperature(temp);
+    // Any accepted reading shows the sensor is alive, even if the unit
+    // doesn't need to hear about it.
+    this->remote_temperature_active_ = true;
+    this->last_remote_temperature_sensor_update_ = millis();
+    this->schedule_remote_temperature_deadline_();
+    if (result == RemoteTemperatureFilter::WRITE) {
+        ESP_LOGD(TAG, "Writing remote temp: %.1f", conditioned);
+        this->hp->setRemoteTemperature(conditioned);
+    }
+}
+
+void MitsubishiHeatPump::set_remote_temperature_filter(
+            RemoteTemperatureSmoothing smoothing,
+            uint8_t window_size,
+            float alpha,
+            float outlier_threshold,
+            float quantization) {
+    RemoteTemperatureFilterConfig config;
+    config.smoothing = smoothing;
+    config.window_size = window_size;
+    config.alpha = alpha;
+    config.outlier_threshold = outlier_threshold;
+    config.quantization = quantization;
+    this->remote_temperature_filter_.setConfig(config);
 }
 
 void MitsubishiHeatPump::ping() {
     ESP_LOGD(TAG, "Ping request received");
-    last_ping_request_ = std::chrono::steady_clock::now();
+    if (this->remote_ping_timeout_ > 0) {
+        this->deadlines_.schedule(DEADLINE_PING, millis() + this->remote_ping_timeout_);
+    }
 }
 
 void MitsubishiHeatPump::set_remote_operating_timeout_minutes(int minutes) {
     ESP_LOGD(TAG, "Setting remote operating timeout time: %d minutes", minutes);
-    remote_operating_timeout_ = std::chrono::minutes(minutes);
+    remote_operating_timeout_ = minutes * 60 * 1000;
 }
 
 void MitsubishiHeatPump::set_remote_idle_timeout_minutes(int minutes) {
     ESP_LOGD(TAG, "Setting remote idle timeout time: %d minutes", minutes);
-    remote_idle_timeout_ = std::chrono::minutes(minutes);
+    remote_idle_timeout_ = minutes * 60 * 1000;
 }
 
 void MitsubishiHeatPump::set_remote_ping_timeout_minutes(int minutes) {
     ESP_LOGD(TAG, "Setting remote ping timeout time: %d minutes", minutes);
-    remote_ping_timeout_ = std::chrono::minutes(minutes);
-}
-
-void MitsubishiHeatPump::enforce_remote_temperature_sensor_timeout() {
-    // Handle ping timeouts.
-    if (remote_ping_timeout_.has_value() && last_ping_request_.has_value()) {
-        auto time_since_last_ping =
-            std::chrono::steady_clock::now() - last_ping_request_.value();
-        if(time_since_last_ping > remote_ping_timeout_.value()) {
-            ESP_LOGW(TAG, "Ping timeout.");
-            this->set_remote_temperature(0);
-            last_ping_request_.reset();
-            return;
+    remote_ping_timeout_ = minutes * 60 * 1000;
+}
+
+void MitsubishiHeatPump::set_zone_weight(float weight) {
+    ESP_LOGD(TAG, "Setting zone weight: %.2f", weight);
+    this->zone_weight_ = weight;
+    this->peer_link_.setWeight(weight);
+}
+
+void MitsubishiHeatPump::set_zone_expiry_minutes(int minutes) {
+    ESP_LOGD(TAG, "Setting zone expiry time: %d minutes", minutes);
+    this->zone_consistency_controller_.setZoneExpiry(minutes * 60 * 1000);
+}
+
+void MitsubishiHeatPump::set_adaptive_polling(uint32_t max_interval_ms) {
+    this->adaptive_polling_max_interval_ = max_interval_ms;
+    this->poller_.setEnabled(true);
+}
+
+void MitsubishiHeatPump::set_effective_poll_interval_sensor(
+    sensor::Sensor *poll_interval_sensor) {
+    this->effective_poll_interval_sensor_ = poll_interval_sensor;
+}
+
+void MitsubishiHeatPump::set_first_settings_time_sensor(
+        esphome::sensor::Sensor *first_settings_time_sensor) {
+    this->first_settings_time_sensor_ = first_settings_time_sensor;
+}
+
+void MitsubishiHeatPump::set_reconnects_sensor(esphome::sensor::Sensor *reconnects_sensor) {
+    this->reconnects_sensor_ = reconnects_sensor;
+}
+
+void MitsubishiHeatPump::publish_connection_sensors_() {
+    uint32_t first_settings_time = this->connection_.getTimeToFirstSettings();
+    if (this->first_settings_time_sensor_ != nullptr && first_settings_time > 0) {
+        this->first_settings_time_sensor_->publish_state(first_settings_time);
+    }
+    if (this->reconnects_sensor_ != nullptr) {
+        this->reconnects_sensor_->publish_state(this->connection_.getReconnects());
+    }
+}
+
+void MitsubishiHeatPump::set_runtime_sensor(
+    RuntimeCounter counter, sensor::Sensor *runtime_sensor) {
+    this->runtime_sensors_[counter] = runtime_sensor;
+}
+
+void MitsubishiHeatPump::publish_runtime_sensors_() {
+    for (uint8_t i = 0; i < RUNTIME_COUNTER_COUNT; i++) {
+        if (this->runtime_sensors_[i] != nullptr) {
+            this->runtime_sensors_[i]->publish_state(
+                this->runtime_.getCounter(static_cast<RuntimeCounter>(i)));
         }
     }
+}
 
-    // Handle set_remote_temperature timeouts.
-    auto remote_set_temperature_timeout =
-        this->operating_ ? remote_operating_timeout_ : remote_idle_timeout_;
-    if (remote_set_temperature_timeout.has_value() &&
-            last_remote_temperature_sensor_update_.has_value()) {
-        auto time_since_last_temperature_update =
-            std::chrono::steady_clock::now() - last_remote_temperature_sensor_update_.value();
-        if (time_since_last_temperature_update > remote_set_temperature_timeout.value()) {
-            ESP_LOGW(TAG, "Set remote temperature timeout, operating=%d", this->operating_);
-            this->set_remote_temperature(0);
-            return;
+void MitsubishiHeatPump::set_mode_arbiter(
+            float deadband,
+            uint32_t min_run_time_ms,
+            uint32_t min_off_time_ms,
+            uint32_t switch_cooldown_ms) {
+    this->mode_arbiter_config_.deadband = deadband;
+    this->mode_arbiter_config_.min_run_time_ms = min_run_time_ms;
+    this->mode_arbiter_config_.min_off_time_ms = min_off_time_ms;
+    this->mode_arbiter_config_.switch_cooldown_ms = switch_cooldown_ms;
+}
+
+void MitsubishiHeatPump::setup_deadlines_() {
+    this->deadlines_.setHandler(DEADLINE_PING, [this]() {
+        ESP_LOGW(TAG, "Ping timeout.");
+        this->set_remote_temperature(0);
+    });
+    this->deadlines_.setHandler(DEADLINE_REMOTE_TEMPERATURE, [this]() {
+        ESP_LOGW(TAG, "Set remote temperature timeout, operating=%d", this->operating_);
+        this->set_remote_temperature(0);
+    });
+    this->deadlines_.setHandler(DEADLINE_ZONE_EXPIRY, [this]() {
+        this->zone_consistency_controller_.expireStaleZones();
+        this->schedule_zone_expiry_deadline_();
+    });
+    this->deadlines_.setHandler(DEADLINE_SENSOR_EXPIRY, [this]() {
+        if (this->temperature_fusion_.expire(millis()) > 0) {
+            this->apply_fused_temperature_();
         }
+        this->schedule_sensor_expiry_deadline_();
+    });
+
+    // Assume a successful connection was made to the ESPHome controller on
+    // launch, so a controller that never pings still times out.
+    if (this->remote_ping_timeout_ > 0) {
+        this->deadlines_.schedule(DEADLINE_PING, millis() + this->remote_ping_timeout_);
+    }
+}
+
+void MitsubishiHeatPump::schedule_remote_temperature_deadline_() {
+    uint32_t timeout =
+        this->operating_ ? remote_operating_timeout_ : remote_idle_timeout_;
+    if (!this->remote_temperature_active_ || timeout == 0) {
+        this->deadlines_.cancel(DEADLINE_REMOTE_TEMPERATURE);
+        return;
+    }
+    this->deadlines_.schedule(
+        DEADLINE_REMOTE_TEMPERATURE,
+        this->last_remote_temperature_sensor_update_ + timeout);
+}
+
+void MitsubishiHeatPump::schedule_zone_expiry_deadline_() {
+    uint32_t due;
+    if (this->zone_consistency_controller_.nextZoneExpiry(&due)) {
+        this->deadlines_.schedule(DEADLINE_ZONE_EXPIRY, due);
+    } else {
+        this->deadlines_.cancel(DEADLINE_ZONE_EXPIRY);
+    }
+}
+
+void MitsubishiHeatPump::schedule_sensor_expiry_deadline_() {
+    uint32_t due;
+    if (this->temperature_fusion_.nextExpiry(&due)) {
+        this->deadlines_.schedule(DEADLINE_SENSOR_EXPIRY, due);
+    } else {
+        this->deadlines_.cancel(DEADLINE_SENSOR_EXPIRY);
     }
 }
 
@@ -746,6 +1055,54 @@ void MitsubishiHeatPump::report_neighbor_temperature(
         temperature_low,
         temperature_high,
         temperature_current);
+    this->schedule_zone_expiry_deadline_();
+}
+
+void MitsubishiHeatPump::set_peer_link(
+            const std::string& group,
+            uint8_t address_0,
+            uint8_t address_1,
+            uint8_t address_2,
+            uint8_t address_3,
+            uint16_t port) {
+    ESP_LOGD(TAG, "Setting peer link group: %s", group.c_str());
+    this->peer_link_.configure(
+        ZoneTable::internId(group),
+        IPAddress(address_0, address_1, address_2, address_3),
+        port);
+}
+
+/**
+ * Publish the state saved before the last reboot, so the entity is usable
+ * straight away rather than after the first read from the unit. The first
+ * sync overwrites anything that changed in the meantime.
+ */
+void MitsubishiHeatPump::restore_state_() {
+    this->hp->restoreDesiredModeOverride(this->preferences_.getModeOverride());
+
+    if (heat_setpoint.has_value()) {
+        this->target_temperature_low = heat_setpoint.value();
+    }
+    if (cool_setpoint.has_value()) {
+        this->target_temperature_high = cool_setpoint.value();
+    }
+
+    PersistedUnitState state;
+    if (!this->preferences_.getUnitState(&state)) {
+        return;
+    }
+
+    this->mode = state.mode;
+    this->fan_mode = state.fan_mode;
+    this->swing_mode = state.swing_mode;
+
+    this->update_swing_vertical(state.vane);
+    this->update_swing_horizontal(state.wide_vane);
+
+    ESP_LOGD(TAG, "Restored saved state: mode %i, fan %i, swing %i, vanes %s/%s",
+        this->mode, this->fan_mode.value_or(-1), this->swing_mode,
+        toString(state.vane), toString(state.wide_vane));
+    this->publish_state_now_();
 }
 
 void MitsubishiHeatPump::setup() {
@@ -763,23 +1120,50 @@ void MitsubishiHeatPump::setup() {
     }
     this->check_logger_conflict_();
 
-    // create various setpoint persistence:
-    cool_storage = global_preferences->make_preference<uint8_t>(this->get_object_id_hash() + 1);
-    heat_storage = global_preferences->make_preference<uint8_t>(this->get_object_id_hash() + 2);
-    managed_mode_storage = global_preferences->make_preference<bool>(this->get_object_id_hash() + 3);
-
-    // load values from storage:
-    cool_setpoint = load(cool_storage);
-    heat_setpoint = load(heat_storage);
-    managed_mode = loadBool(managed_mode_storage);
+    // load setpoint persistence:
+    this->preferences_.setup(this->get_object_id_hash());
+    this->runtime_.setup(this->get_object_id_hash());
+    cool_setpoint = this->preferences_.getCoolSetpoint();
+    heat_setpoint = this->preferences_.getHeatSetpoint();
+    managed_mode = this->preferences_.getManagedMode();
 
     ESP_LOGCONFIG(TAG, "Intializing new HeatPump object.");
     this->hp = new TwoPointHeatPump(
         heat_setpoint.value_or(0),
         cool_setpoint.value_or(0),
         managed_mode.value_or(false));
+    this->hp->setModeArbiterConfig(this->mode_arbiter_config_);
+    this->serial_link_ = this->serial_scheduler_.registerLink();
+    this->poller_.configure(
+        this->get_update_interval(), this->adaptive_polling_max_interval_);
 
     this->zone_consistency_controller_.setHeatpumpController(this->hp);
+    this->setup_deadlines_();
+
+    if (this->peer_link_.isConfigured()) {
+        // Identify this head by node name and entity, so several heads on
+        // one node (or identically named entities on different nodes) stay
+        // distinct.
+        this->peer_link_.setSender(
+            ZoneTable::internId(App.get_name()) ^ this->get_object_id_hash());
+        this->peer_link_.setReportCallback(
+            [this](uint32_t sender,
+                   bool heat_cool,
+                   float temperature_low,
+                   float temperature_high,
+                   float temperature_current,
+                   float weight) {
+                this->zone_consistency_controller_.zoneUpdate(
+                    sender,
+                    heat_cool,
+                    temperature_low,
+                    temperature_high,
+                    temperature_current,
+                    weight);
+                this->schedule_zone_expiry_deadline_();
+            }
+        );
+    }
     this->hp->enableExternalUpdate();
     this->current_temperature = NAN;
     this->target_temperature_low = NAN;
@@ -787,23 +1171,37 @@ void MitsubishiHeatPump::setup() {
 
     this->fan_mode = climate::CLIMATE_FAN_OFF;
     this->swing_mode = climate::CLIMATE_SWING_OFF;
-    this->vertical_swing_state_ = "auto";
-    this->horizontal_swing_state_ = "auto";
+    this->vertical_swing_state_ = HeatpumpVaneSetting::AUTO;
+    this->horizontal_swing_state_ = HeatpumpWideVaneSetting::LEFT_RIGHT;
+    this->restore_state_();
+    hp->setModeOverrideChangedCallback(
+            [this](HeatpumpMode mode) {
+                this->preferences_.setModeOverride(mode);
+            }
+    );
 
 #ifdef USE_CALLBACKS
     hp->setSettingsChangedCallback(
             [this]() {
+                ScopedTiming timing(this->timings_, TIMING_SETTINGS_CALLBACK);
                 this->hpSettingsChanged();
             }
     );
 
     hp->setStatusChangedCallback(
             [this](heatpumpStatus currentStatus) {
+                ScopedTiming timing(this->timings_, TIMING_STATUS_CALLBACK);
                 this->hpStatusChanged(currentStatus);
             }
     );
 
-    hp->setPacketCallback(this->log_packet);    
+    hp->setPacketCallback(
+            [this](byte* packet, unsigned int length, char* packetDirection) {
+                this->link_statistics_.onPacket(packetDirection);
+                this->packet_trace_.record(millis(), packetDirection, packet, length);
+                this->log_packet(packet, length, packetDirection);
+            }
+    );
 #endif
 
     ESP_LOGCONFIG(
@@ -814,52 +1212,13 @@ void MitsubishiHeatPump::setup() {
             YESNO((void *)this->get_hw_serial_() == (void *)&Serial)
     );
 
-    ESP_LOGCONFIG(TAG, "Calling hp->connect(%p)", this->get_hw_serial_());
-    if (hp->connect(this->get_hw_serial_(), this->baud_, this->rx_pin_, this->tx_pin_)) {
-        hp->sync();
-    }
-    else {
-        ESP_LOGCONFIG(
-                TAG,
-                "Connection to HeatPump failed."
-                " Marking MitsubishiHeatPump component as failed."
-        );
-        this->mark_failed();
-    }
+    // Connect from the main loop, retrying with backoff until the unit
+    // answers, instead of failing the component if it's slow to start.
+    this->connection_.begin(millis());
 
     this->dump_config();
 }
 
-/**
- * The ESP only has a few bytes of rtc storage, so instead
- * of storing floats directly, we'll store the number of
- * TEMPERATURE_STEPs from MIN_TEMPERATURE.
- **/
-void MitsubishiHeatPump::save(float value, ESPPreferenceObject& storage) {
-    uint8_t steps = (value - ESPMHP_MIN_TEMPERATURE) / ESPMHP_TEMPERATURE_STEP;
-    storage.save(&steps);
-}
-
-void MitsubishiHeatPump::save(bool value, ESPPreferenceObject& storage) {
-    storage.save(&value);
-}
-
-optional<float> MitsubishiHeatPump::load(ESPPreferenceObject& storage) {
-    uint8_t steps = 0;
-    if (!storage.load(&steps)) {
-        return {};
-    }
-    return ESPMHP_MIN_TEMPERATURE + (steps * ESPMHP_TEMPERATURE_STEP);
-}
-
-optional<bool> MitsubishiHeatPump::loadBool(ESPPreferenceObject& storage) {
-    bool result = false;
-    if (!storage.load(&result)) {
-        return {};
-    }
-    return result;
-}
-
 void MitsubishiHeatPump::dump_config() {
     this->banner();
     ESP_LOGI(TAG, "  Supports HEAT: %s", YESNO(true));
@@ -867,6 +1226,72 @@ void MitsubishiHeatPump::dump_config() {
     ESP_LOGI(TAG, "  Supports AWAY mode: %s", YESNO(false));
     ESP_LOGI(TAG, "  Saved heat: %.1f", heat_setpoint.value_or(-1));
     ESP_LOGI(TAG, "  Saved cool: %.1f", cool_setpoint.value_or(-1));
+    ESP_LOGI(TAG, "  Event driven RX: %s", YESNO(this->event_driven_rx_));
+    ESP_LOGI(TAG, "  Zone arbitration: %s", ZoneArbitration::name());
+    ESP_LOGI(TAG, "  Adaptive polling: %s", YESNO(this->poller_.isEnabled()));
+    ESP_LOGI(TAG, "  Mode deadband: %.1f, min run/off: %u/%u s, switch cooldown: %u s",
+        this->mode_arbiter_config_.deadband,
+        this->mode_arbiter_config_.min_run_time_ms / 1000,
+        this->mode_arbiter_config_.min_off_time_ms / 1000,
+        this->mode_arbiter_config_.switch_cooldown_ms / 1000);
+    this->link_statistics_.log(TAG);
+    this->log_statistics();
+}
+
+void MitsubishiHeatPump::log_statistics() {
+    if (this->hp == nullptr) {
+        return;
+    }
+    uint32_t requested = this->hp->getWritesRequested();
+    uint32_t sent = this->hp->getWritesSent();
+    ESP_LOGD(TAG, "Writes: %u requested, %u sent, %u saved by coalescing",
+        requested, sent, requested - sent);
+    const CommandReconciler& reconciler = this->hp->getReconciler();
+    const RunningStats& confirm_latency = reconciler.getConfirmLatency();
+    const RecentSamples& recent_latency = reconciler.getRecentConfirmLatency();
+    ESP_LOGD(TAG, "Readbacks: %u fields confirmed, %u retried, %u failed, %u stale readbacks held back",
+        reconciler.getConfirmed(), reconciler.getRetries(), reconciler.getFailures(),
+        reconciler.getSuppressed());
+    ESP_LOGD(TAG, "Apply latency: min/avg/max %u/%u/%u ms, p50/p99 of last %u: %u/%u ms",
+        confirm_latency.min, confirm_latency.average(), confirm_latency.max,
+        recent_latency.size(), recent_latency.percentile(50), recent_latency.percentile(99));
+    ESP_LOGD(TAG, "Publishes: %u sent, %u suppressed",
+        this->publish_gate_.getPublishCount(), this->publish_gate_.getSuppressedCount());
+    ESP_LOGD(TAG, "Preferences: %u writes for %u changes",
+        this->preferences_.getWriteCount(), this->preferences_.getChangeCount());
+    ESP_LOGD(TAG, "Runtime: compressor %.2f h, %.0f starts, %.1f Hz h, %u checkpoints",
+        this->runtime_.getCounter(RUNTIME_COMPRESSOR),
+        this->runtime_.getCounter(RUNTIME_COMPRESSOR_STARTS),
+        this->runtime_.getCounter(RUNTIME_FREQUENCY_HOURS),
+        this->runtime_.getCheckpoints());
+    if (this->peer_link_.isConfigured()) {
+        const PeerProtocol& peers = this->peer_link_.getProtocol();
+        ESP_LOGD(TAG, "Peer link: %u reports sent, %u received, %u lost, %u out of order",
+            peers.getPacketsSent(), peers.getPacketsReceived(),
+            peers.getPacketsLost(), peers.getPacketsOutOfOrder());
+    }
+    ESP_LOGD(TAG, "Connection: %s, %u attempts, %u failed, %u reconnects, first settings after %u ms",
+        ConnectionMonitor::stateName(this->connection_.getState()),
+        this->connection_.getAttempts(), this->connection_.getFailures(),
+        this->connection_.getReconnects(), this->connection_.getTimeToFirstSettings());
+    const ModeArbiter& arbiter = this->hp->getModeArbiter();
+    ESP_LOGD(TAG, "Mode arbiter: %u mode switches, %u held off, %u compressor starts",
+        arbiter.getModeSwitches(), arbiter.getSwitchesHeldOff(), arbiter.getCompressorStarts());
+    const RemoteTemperatureFilter& filter = this->remote_temperature_filter_;
+    ESP_LOGD(TAG, "Remote temperature: %u readings, %u writes, %u saved, %u outliers",
+        filter.getReadings(), filter.getWrites(), filter.getWritesSaved(), filter.getRejected());
+    const TemperatureFusion& fusion = this->temperature_fusion_;
+    ESP_LOGD(TAG, "Remote sensors: %u active, %u outliers excluded, %u expired",
+        fusion.getActiveCount(), fusion.getOutliersExcluded(), fusion.getSensorsExpired());
+    if (this->serial_scheduler_.getLinkCount() > 1 &&
+        this->serial_link_ != SerialScheduler::NO_LINK) {
+        const RunningStats& wait = this->serial_scheduler_.getWaitTime(this->serial_link_);
+        ESP_LOGD(TAG, "Serial scheduler: link %u of %u, wait min/avg/max %u/%u/%u ms",
+            this->serial_link_ + 1, this->serial_scheduler_.getLinkCount(),
+            wait.min, wait.average(), wait.max);
+    }
+    this->deadlines_.log(TAG, millis());
+    this->timings_.log(TAG);
 }
 
 void MitsubishiHeatPump::dump_state() {
@@ -875,14 +1300,25 @@ void MitsubishiHeatPump::dump_state() {
 }
 
 void MitsubishiHeatPump::log_packet(byte* packet, unsigned int length, char* packetDirection) {
-    String packetHex;
-    char textBuf[15];
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+    char packetHex[PacketTrace::HEX_LENGTH];
+    PacketTrace::formatHex(packet, length, packetHex);
+    ESP_LOGV(TAG, "PKT: [%s] %s", packetDirection, packetHex);
+#endif
+}
+
+void MitsubishiHeatPump::dump_packet_trace() {
+    this->packet_trace_.dumpHex(TAG);
+}
 
-    for (int i = 0; i < length; i++) {
-        memset(textBuf, 0, 15);
-        sprintf(textBuf, "%02X ", packet[i]);
-        packetHex += textBuf;
+void MitsubishiHeatPump::dump_packet_trace_pcap(Print* out) {
+    if (out == nullptr) {
+        ESP_LOGW(TAG, "No output given for the packet trace capture");
+        return;
+    }
+    if (out == this->get_hw_serial_()) {
+        ESP_LOGW(TAG, "Not writing the packet trace capture to the heat pump's UART");
+        return;
     }
-    
-    ESP_LOGV(TAG, "PKT: [%s] %s", packetDirection, packetHex.c_str());
+    this->packet_trace_.writePcap(*out);
 }
\ No newline at end of file
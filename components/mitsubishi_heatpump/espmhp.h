@@ -19,9 +19,22 @@
 
 #include "esphome.h"
 #include "esphome/components/select/select.h"
+#include "esphome/components/sensor/sensor.h"
 #include "esphome/core/preferences.h"
-#include <chrono>
 
+#include "AdaptivePoller.h"
+#include "ConnectionMonitor.h"
+#include "DeadlineScheduler.h"
+#include "HotPathTimings.h"
+#include "LinkStatistics.h"
+#include "PacketTrace.h"
+#include "PeerLink.h"
+#include "PreferenceCache.h"
+#include "PublishGate.h"
+#include "RemoteTemperatureFilter.h"
+#include "RuntimeAccounting.h"
+#include "SerialScheduler.h"
+#include "TemperatureFusion.h"
 #include "TwoPointHeatPump.h"
 #include "ZoneConsistencyController.h"
 
@@ -42,6 +55,40 @@ static const uint8_t ESPMHP_MAX_TEMPERATURE = 31; // degrees C,
                                                   //defined by hardware
 static const float   ESPMHP_TEMPERATURE_STEP = 0.5; // temperature setting step,
                                                     // in degrees C
+static const uint32_t ESPMHP_STATISTICS_LOG_INTERVAL = 60000; // in milliseconds
+static const uint32_t ESPMHP_PREFERENCE_QUIET_PERIOD = 30000; // in milliseconds,
+                                                              // before saving
+                                                              // setpoint changes
+
+// ESPHome fan modes, indexed by HeatpumpFanSetting.
+static const esphome::climate::ClimateFanMode ESPMHP_FAN_MODES[] = {
+    esphome::climate::CLIMATE_FAN_AUTO,    // AUTO
+    esphome::climate::CLIMATE_FAN_DIFFUSE, // QUIET
+    esphome::climate::CLIMATE_FAN_LOW,     // SPEED_1
+    esphome::climate::CLIMATE_FAN_MEDIUM,  // SPEED_2
+    esphome::climate::CLIMATE_FAN_MIDDLE,  // SPEED_3
+    esphome::climate::CLIMATE_FAN_HIGH,    // SPEED_4
+    esphome::climate::CLIMATE_FAN_AUTO,    // UNKNOWN
+};
+
+// Vertical vane select options, indexed by HeatpumpVaneSetting. Must match
+// VERTICAL_SWING_OPTIONS in climate.py and __init__.py, as the select's
+// option index is used as the vane setting.
+static const char* const ESPMHP_VERTICAL_VANE_OPTIONS[] = {
+    "auto", "up", "up_center", "center", "down_center", "down", "swing", nullptr
+};
+
+// Horizontal vane select options, indexed by HeatpumpWideVaneSetting. Must
+// match HORIZONTAL_SWING_OPTIONS in climate.py and __init__.py.
+static const char* const ESPMHP_HORIZONTAL_VANE_OPTIONS[] = {
+    "left", "left_center", "center", "right_center", "right", "auto", "swing", nullptr
+};
+
+/* Responses from the unit are fixed length packets. In event driven mode the
+UART is only handed to the HeatPump library once a full packet is buffered, so
+the library never blocks the main loop waiting on the remaining bytes.*/
+static const int      ESPMHP_RX_PACKET_LENGTH = 22; // in bytes
+static const uint32_t ESPMHP_RX_DRAIN_INTERVAL = 50; // in milliseconds
 
 class MitsubishiHeatPump : public esphome::PollingComponent, public esphome::climate::Climate {
 
@@ -86,6 +133,17 @@ class MitsubishiHeatPump : public esphome::PollingComponent, public esphome::cli
         // This is called every poll_interval.
         void update() override;
 
+        // Save any pending preference changes before rebooting.
+        void on_shutdown() override;
+
+        // This is called every main loop iteration. In event driven mode it
+        // hands buffered responses to the HeatPump library as they arrive.
+        void loop() override;
+
+        // Process responses from the unit as soon as they arrive rather than
+        // on the next poll. Must be called before setup() to have any effect.
+        void set_event_driven_rx(bool event_driven_rx);
+
         // Configure the climate object with traits that we support.
         esphome::climate::ClimateTraits traits() override;
 
@@ -102,13 +160,47 @@ class MitsubishiHeatPump : public esphome::PollingComponent, public esphome::cli
         // set_remote_temp(0) to switch back to the internal sensor.
         void set_remote_temperature(float);
 
+        // Use the temperature from one of several external sensors in the
+        // room. Readings from all sensors that reported recently are fused
+        // before being written to the unit. Use set_remote_temperature(sensor, 0)
+        // to stop using that sensor.
+        void set_remote_temperature(const std::string& sensor, float temp);
+
+        // Follow a sensor's state as one of the remote temperature sensors.
+        // The sensor is dropped if it doesn't report within max_age_ms, 0
+        // keeps its last reading.
+        void add_remote_temperature_sensor(
+            esphome::sensor::Sensor* sensor, float weight, uint32_t max_age_ms);
+
+        // Configure how readings passed to set_remote_temperature() are
+        // conditioned before being written to the unit.
+        void set_remote_temperature_filter(
+            RemoteTemperatureSmoothing smoothing,
+            uint8_t window_size,
+            float alpha,
+            float outlier_threshold,
+            float quantization);
+
         void set_vertical_vane_select(esphome::select::Select *vertical_vane_select);
         void set_horizontal_vane_select(esphome::select::Select *horizontal_vane_select);
 
+        // Publish the slowest call of a hot path phase over each statistics
+        // interval, in microseconds.
+        void set_timing_sensor(TimingPhase phase, esphome::sensor::Sensor *timing_sensor);
+
         // Used to validate that a connection is present between the controller
         // and this heatpump.
         void ping();
 
+        // Only publish current temperature changes at least this large, in
+        // degrees C.
+        void set_publish_temperature_threshold(float threshold);
+
+        // Publish current temperature changes at most once per interval, in
+        // milliseconds. Mode, action, fan, swing and setpoint changes are
+        // always published immediately.
+        void set_min_publish_interval(uint32_t interval_ms);
+
         // Number of minutes before the heatpump reverts back to the internal
         // temperature sensor if the machine is currently operating.
         void set_remote_operating_timeout_minutes(int);
@@ -121,6 +213,49 @@ class MitsubishiHeatPump : public esphome::PollingComponent, public esphome::cli
         // temperature sensor if a ping isn't received from the controller.
         void set_remote_ping_timeout_minutes(int);
 
+        // Number of minutes before a neighboring zone that stopped reporting
+        // is ignored by the multizone negotiation.
+        void set_zone_expiry_minutes(int);
+
+        // Relative importance of this head's zone, reported to the other
+        // heads over the peer link for weighted arbitration.
+        void set_zone_weight(float weight);
+
+        // Back off polling toward max_interval_ms while the unit is idle and
+        // stable, returning to update_interval after any activity.
+        void set_adaptive_polling(uint32_t max_interval_ms);
+
+        // Publish the average time between syncs with the unit over each
+        // statistics interval, in milliseconds.
+        void set_effective_poll_interval_sensor(esphome::sensor::Sensor *poll_interval_sensor);
+
+        // Publish the time from boot until the unit first reported its
+        // settings, in milliseconds, and the number of reconnects since.
+        void set_first_settings_time_sensor(esphome::sensor::Sensor *first_settings_time_sensor);
+        void set_reconnects_sensor(esphome::sensor::Sensor *reconnects_sensor);
+
+        // Publish a compressor runtime, start count, energy proxy or time per
+        // mode total, see RuntimeCounter.
+        void set_runtime_sensor(RuntimeCounter counter, esphome::sensor::Sensor *runtime_sensor);
+
+        // Configure how managed dual point mode switches between HEAT and
+        // COOL, see ModeArbiterConfig.
+        void set_mode_arbiter(
+            float deadband,
+            uint32_t min_run_time_ms,
+            uint32_t min_off_time_ms,
+            uint32_t switch_cooldown_ms);
+
+        // Exchange dual point state directly with the other heads in group over
+        // UDP multicast, instead of relying on report_neighbor_temperature.
+        void set_peer_link(
+            const std::string& group,
+            uint8_t address_0,
+            uint8_t address_1,
+            uint8_t address_2,
+            uint8_t address_3,
+            uint16_t port);
+
         // Set the temperature deltas for neighboring zones associated with this
         // multisplit. temperature_delta is defined as target_temperature - current_temperature
         void report_neighbor_temperature(
@@ -130,19 +265,28 @@ class MitsubishiHeatPump : public esphome::PollingComponent, public esphome::cli
             float temperature_high,
             float temperature_current);
 
+        // Write the most recent CN105 packets to the log as hex, or to out
+        // as a pcap capture, e.g. id(hp).dump_packet_trace_pcap(&Serial1)
+        // for a spare UART on an ESP32. Refused for the heat pump's UART.
+        void dump_packet_trace();
+        void dump_packet_trace_pcap(Print* out);
+
     protected:
         // HeatPump object using the underlying Arduino library.
-        TwoPointHeatPump* hp;
+        TwoPointHeatPump* hp = nullptr;
+        ModeArbiterConfig mode_arbiter_config_;
         ZoneConsistencyController zone_consistency_controller_;
+        PeerLink peer_link_;
+        float zone_weight_ = 1;
 
         // The ClimateTraits supported by this HeatPump.
         esphome::climate::ClimateTraits traits_;
 
         // Vane position
-        void update_swing_horizontal(const std::string &swing);
-        void update_swing_vertical(const std::string &swing);
-        std::string vertical_swing_state_;
-        std::string horizontal_swing_state_;
+        void update_swing_horizontal(HeatpumpWideVaneSetting wide_vane);
+        void update_swing_vertical(HeatpumpVaneSetting vane);
+        HeatpumpVaneSetting vertical_swing_state_ = HeatpumpVaneSetting::AUTO;
+        HeatpumpWideVaneSetting horizontal_swing_state_ = HeatpumpWideVaneSetting::LEFT_RIGHT;
 
         // Allow the HeatPump class to use get_hw_serial_
         friend class TwoPointHeatPump;
@@ -158,48 +302,98 @@ class MitsubishiHeatPump : public esphome::PollingComponent, public esphome::cli
 
         // various prefs to save mode-specific temperatures, akin to how the IR
         // remote works.
-        esphome::ESPPreferenceObject heat_storage;
-        esphome::ESPPreferenceObject cool_storage;
-        esphome::ESPPreferenceObject managed_mode_storage;
+        PreferenceCache preferences_{
+            ESPMHP_MIN_TEMPERATURE,
+            ESPMHP_TEMPERATURE_STEP,
+            ESPMHP_PREFERENCE_QUIET_PERIOD};
 
         esphome::optional<float> heat_setpoint;
         esphome::optional<float> cool_setpoint;
         esphome::optional<bool> managed_mode;
 
-        static void save(float value, esphome::ESPPreferenceObject& storage);
-        static esphome::optional<float> load(esphome::ESPPreferenceObject& storage);
-
-        static void save(bool value, esphome::ESPPreferenceObject& storage);
-        static esphome::optional<bool> loadBool(esphome::ESPPreferenceObject& storage);
-
         esphome::select::Select *vertical_vane_select_ =
             nullptr;  // Select to store manual position of vertical swing
         esphome::select::Select *horizontal_vane_select_ =
             nullptr;  // Select to store manual position of horizontal swing
 
         // When received command to change the vane positions
-        void on_horizontal_swing_change(const std::string &swing);
-        void on_vertical_swing_change(const std::string &swing);
+        void on_horizontal_swing_change(HeatpumpWideVaneSetting wide_vane);
+        void on_vertical_swing_change(HeatpumpVaneSetting vane);
 
         static void log_packet(byte* packet, unsigned int length, char* packetDirection);
 
+        // Ring buffer of the most recent packets in both directions.
+        PacketTrace packet_trace_;
+
+        // Packet, latency and timing counters for the CN105 link.
+        LinkStatistics link_statistics_;
+        HotPathTimings timings_;
+
+        // Serial work is done in turns shared with the other heatpumps on
+        // this node. A sync requested by update() or event driven RX waits
+        // in sync_requested_ until this link's turn.
+        SerialScheduler& serial_scheduler_ = SerialScheduler::shared();
+        uint8_t serial_link_ = SerialScheduler::NO_LINK;
+        bool sync_requested_ = false;
+        bool rx_packet_ready_();
+        void service_serial_();
+        // Connects, and reconnects, with backoff from the main loop.
+        ConnectionMonitor connection_;
+        esphome::sensor::Sensor *first_settings_time_sensor_ = nullptr;
+        esphome::sensor::Sensor *reconnects_sensor_ = nullptr;
+        void publish_connection_sensors_();
+        // Compressor runtime and energy totals, persisted across reboots.
+        RuntimeAccounting runtime_;
+        esphome::sensor::Sensor *runtime_sensors_[RUNTIME_COUNTER_COUNT] = {};
+        void publish_runtime_sensors_();
+        AdaptivePoller poller_;
+        uint32_t adaptive_polling_max_interval_ = 0;
+        esphome::sensor::Sensor *effective_poll_interval_sensor_ = nullptr;
+        esphome::sensor::Sensor *timing_sensors_[TIMING_PHASE_COUNT] = {};
+        void publish_timing_sensors_();
+        uint32_t last_statistics_log_ = 0;
+        void log_statistics();
+
+        // Skips publishing states that haven't meaningfully changed since the
+        // last publish.
+        PublishGate publish_gate_;
+        void publish_state_if_changed_();
+        void publish_state_now_();
+        PublishedClimateState published_state_();
+
     private:
-        void enforce_remote_temperature_sensor_timeout();
+        // Timeouts for the remote temperature sensor, ping and zones.
+        DeadlineScheduler deadlines_;
+        void setup_deadlines_();
+        void restore_state_();
+        void schedule_remote_temperature_deadline_();
+        void schedule_zone_expiry_deadline_();
+        void schedule_sensor_expiry_deadline_();
+        void report_remote_temperature_(uint32_t sensor, float temp);
+        void apply_fused_temperature_();
+        void revert_to_internal_temperature_();
 
         // Retrieve the HardwareSerial pointer from friend and subclasses.
         HardwareSerial *hw_serial_;
         int baud_ = 0;
         int rx_pin_ = -1;
         int tx_pin_ = -1;
+        bool event_driven_rx_ = false;
+        uint32_t last_rx_drain_ = 0;
         bool operating_ = false;
         bool heat_cool_mode_ = false;
 
-        std::map<std::string, std::pair<std::chrono::time_point<std::chrono::steady_clock>, float>> remote_temperature_deltas_;
-        esphome::optional<std::chrono::duration<long long, std::ratio<60>>> remote_operating_timeout_;
-        esphome::optional<std::chrono::duration<long long, std::ratio<60>>> remote_idle_timeout_;
-        esphome::optional<std::chrono::duration<long long, std::ratio<60>>> remote_ping_timeout_;
-        esphome::optional<std::chrono::time_point<std::chrono::steady_clock>> last_remote_temperature_sensor_update_;
-        esphome::optional<std::chrono::time_point<std::chrono::steady_clock>> last_ping_request_;
+        // Timeouts in milliseconds, 0 if not configured.
+        uint32_t remote_operating_timeout_ = 0;
+        uint32_t remote_idle_timeout_ = 0;
+        uint32_t remote_ping_timeout_ = 0;
+        // Whether the unit is using a remote temperature, and when the remote
+        // sensor last reported.
+        bool remote_temperature_active_ = false;
+        uint32_t last_remote_temperature_sensor_update_ = 0;
+        RemoteTemperatureFilter remote_temperature_filter_;
+        // Latest reading of each remote sensor, fused before filtering.
+        TemperatureFusion temperature_fusion_;
 };
 
 #endif
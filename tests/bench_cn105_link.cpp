@@ -0,0 +1,155 @@
+// Command latency and link cost of TwoPointHeatPump against an emulated unit.
+//
+// Drives TwoPointHeatPump the way MitsubishiHeatPump does: control() queues
+// a command, and every update_interval a poll syncs with the unit and writes
+// whatever was queued since. The HeatPump library is the fake from stubs/, whose emulated unit
+// answers CN105 packets with the library's pacing on a simulated clock, so
+// an hour of operation runs in well under a second. Reported per scenario:
+// command-to-ack latency and packets per command as LinkStatistics measures
+// them on the device, SET packets per command, retries, and the CPU time of
+// one update() cycle.
+
+#include "LinkStatistics.h"
+#include "TwoPointHeatPump.h"
+#include "check.h"
+
+#include <chrono>
+#include <cstdlib>
+
+static const uint32_t UPDATE_INTERVAL_MS = 500;
+static const uint32_t COMMAND_INTERVAL_MS = 30 * 1000;
+static const uint32_t SIMULATED_MS = 60 * 60 * 1000;
+// Quiet time at the end, long enough for every retry to run out.
+static const uint32_t SETTLE_MS = 3 * 60 * 1000;
+
+// The parts of MitsubishiHeatPump between Home Assistant and the unit.
+class HostController {
+public:
+    HostController() : hp_(20, 24, false) {
+        hp_.setPacketCallback([this](byte*, unsigned int, char* packetDirection) {
+            statistics_.onPacket(packetDirection);
+        });
+        CHECK(hp_.connect(nullptr));
+    }
+
+    // As control() for a heat mode call with a setpoint and fan speed.
+    void controlHeat(float temperature, HeatpumpFanSetting fan) {
+        hp_.setModeSetting(HeatpumpModeSetting::HEAT);
+        hp_.setPowerSetting(HeatpumpPowerSetting::ON);
+        hp_.setTemperatureLow(temperature);
+        hp_.setFanSpeed(fan);
+        statistics_.onCommandQueued(millis());
+        hp_.update();
+    }
+
+    // One update_interval: a sync, then any pending write, as update() and
+    // service_serial_() do. Returns the CPU time spent, in nanoseconds.
+    double update() {
+        auto start = std::chrono::steady_clock::now();
+        hp_.sync();
+        // Writes are held until the unit's settings are known.
+        if (hp_.getSettings().isValid()) {
+            WriteResult result = hp_.updateIfChangesPending();
+            if (result != WriteResult::WRITE_NONE) {
+                statistics_.onCommandWritten(millis(), result != WriteResult::WRITE_FAILED);
+            }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    TwoPointHeatPump& hp() { return hp_; }
+    EmulatedUnit& unit() { return hp_.getUnit(); }
+    const LinkStatistics& statistics() const { return statistics_; }
+
+private:
+    TwoPointHeatPump hp_;
+    LinkStatistics statistics_;
+};
+
+struct Scenario {
+    const char* name;
+    int drop_percent;
+    uint8_t stale_readbacks;
+};
+
+// Runs an hour of polling with a command every COMMAND_INTERVAL_MS, then
+// lets the link settle.
+static void run(const Scenario& scenario) {
+    srand(1);
+    simulated_millis = 0;
+    HostController controller;
+    EmulatedUnit& unit = controller.unit();
+    unit.drop_percent = scenario.drop_percent;
+    unit.stale_readbacks = scenario.stale_readbacks;
+
+    uint32_t commands = 0;
+    uint32_t updates = 0;
+    double cpu_ns = 0;
+    uint32_t next_update = 0;
+    uint32_t next_command = 10 * 1000;
+    float last_temperature = 0;
+    HeatpumpFanSetting last_fan = HeatpumpFanSetting::AUTO;
+    while (millis() < SIMULATED_MS + SETTLE_MS) {
+        if (millis() >= next_command) {
+            next_command += COMMAND_INTERVAL_MS;
+            if (next_command >= SIMULATED_MS) {
+                next_command = SIMULATED_MS + SETTLE_MS;
+            }
+            last_temperature = commands % 2 ? 21.5f : 20;
+            last_fan = commands % 3 ? HeatpumpFanSetting::SPEED_2 : HeatpumpFanSetting::AUTO;
+            controller.controlHeat(last_temperature, last_fan);
+            commands++;
+        }
+
+        if (millis() >= next_update) {
+            next_update = millis() + UPDATE_INTERVAL_MS;
+            cpu_ns += controller.update();
+            updates++;
+        } else {
+            // Idle in loop() until the next poll or command.
+            simulated_millis = next_update < next_command ? next_update : next_command;
+        }
+    }
+
+    const LinkStatistics& statistics = controller.statistics();
+    const CommandReconciler& reconciler = controller.hp().getReconciler();
+    const RunningStats& latency = statistics.getAckLatency();
+    const RunningStats& packets = statistics.getPacketsPerCommand();
+    printf("%-16s ack %4u/%4u/%4u ms  packets/command %u/%u/%u  SETs %4u for %3u commands"
+        "  retries %3u  unacked %3u  update() %.1f us\n",
+        scenario.name, latency.min, latency.average(), latency.max,
+        packets.min, packets.average(), packets.max,
+        unit.getSetsReceived(), commands, reconciler.getRetries(),
+        statistics.getUnacknowledgedCommands(), cpu_ns / updates / 1000);
+
+    // Once settled, what's published is what the unit reports.
+    CHECK(!reconciler.hasInFlight());
+    CHECK_EQ(controller.hp().getSettings().temperature, unit.temperature);
+    if (scenario.drop_percent == 0) {
+        CHECK_EQ(unit.temperature, last_temperature);
+        CHECK_EQ(strcmp(unit.fan, toString(last_fan)), 0);
+        // Every command is acknowledged within a poll, the wait for the
+        // packet interval and the library's wait for the acknowledgement.
+        CHECK_EQ(statistics.getUnacknowledgedCommands(), 0u);
+        CHECK_EQ(latency.count, commands);
+        if (scenario.stale_readbacks == 0) {
+            // Confirmed by the next readback, well inside the timeout.
+            CHECK_EQ(reconciler.getRetries(), 0u);
+        }
+        CHECK(latency.max <= UPDATE_INTERVAL_MS + 2 * PACKET_SENT_INTERVAL_MS + 100);
+        CHECK(packets.max <= 4);
+    }
+}
+
+int main() {
+    static const Scenario SCENARIOS[] = {
+        {"clean link", 0, 0},
+        {"stale readbacks", 0, 2},
+        {"30% SETs lost", 30, 0},
+    };
+    for (const Scenario& scenario : SCENARIOS) {
+        run(scenario);
+    }
+    return checkResult();
+}
@@ -0,0 +1,401 @@
+// Convergence of the peer link between simulated heads over loopback UDP.
+//
+// Each head has a PeerProtocol and a ZoneTable fed from its report callback,
+// as MitsubishiHeatPump feeds its ZoneConsistencyController, and a UDP
+// socket on 127.0.0.1. Multicast is stood in for by sending every report to
+// each head's socket, the sender's own included, so reports go through the
+// kernel and PeerProtocol as on the device. The link can lose, duplicate or
+// reorder datagrams on the way.
+//
+// Heads boot a few seconds apart, then report a slowly rising temperature
+// for an hour. Reported per scenario: how long after the last head booted,
+// and after the last change, every head's table held every head's latest
+// report; reports lost and dropped as out of order; and the wall clock cost
+// of a report through the sockets. The cost of building and accepting a
+// report without them is timed separately.
+
+#include "PeerProtocol.h"
+#include "ZoneTable.h"
+#include "check.h"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static const uint8_t HEAD_COUNT = 8;
+static const float LOW = 20;
+static const float HIGH = 24;
+static const uint32_t GROUP = 0x4d48;
+
+static const uint32_t STEP_MS = 1000;
+static const uint32_t BOOT_INTERVAL_MS = 5000;
+static const uint32_t CHURN_MS = 60 * 60 * 1000;
+// Long enough for several heartbeats to make up for lost reports.
+static const uint32_t SETTLE_MS = 15 * 60 * 1000;
+
+struct Scenario {
+    const char* name;
+    // Per datagram and receiver, in percent.
+    int drop_percent;
+    int duplicate_percent;
+    // Held back and delivered after the sender's next report.
+    int reorder_percent;
+};
+
+struct Counts {
+    uint32_t dropped = 0;
+    uint32_t duplicated = 0;
+    uint32_t reordered = 0;
+    uint32_t delivered = 0;
+    uint32_t looped_back = 0;
+    // Reports that rolled a zone back to an older temperature.
+    uint32_t regressions = 0;
+};
+
+struct Head {
+    PeerProtocol protocol;
+    ZoneTable zones;
+    int socket = -1;
+    sockaddr_in address{};
+    bool booted = false;
+    float temperature = 21;
+    // A report held back from each receiver, to be delivered late.
+    std::vector<uint8_t> held[HEAD_COUNT];
+};
+
+static int openSocket(sockaddr_in* address) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    CHECK(fd >= 0);
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address->sin_port = 0;
+    CHECK_EQ(bind(fd, reinterpret_cast<sockaddr*>(address), sizeof(*address)), 0);
+    socklen_t length = sizeof(*address);
+    CHECK_EQ(getsockname(fd, reinterpret_cast<sockaddr*>(address), &length), 0);
+    CHECK_EQ(fcntl(fd, F_SETFL, O_NONBLOCK), 0);
+    return fd;
+}
+
+static void sendTo(const Head& to, const uint8_t* data, size_t length, Counts* counts) {
+    ssize_t sent = sendto(to.socket, data, length, 0,
+        reinterpret_cast<const sockaddr*>(&to.address), sizeof(to.address));
+    CHECK_EQ(sent, (ssize_t) length);
+    counts->delivered++;
+}
+
+// Sends a report from heads[from] to every head through the lossy link.
+static void broadcast(const Scenario& scenario, Head* heads, uint8_t from, const PeerPacket& packet,
+                      Counts* counts) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&packet);
+    for (uint8_t to = 0; to < HEAD_COUNT; to++) {
+        Head& receiver = heads[to];
+        // The sender drops its own reports before looking at the sequence.
+        uint32_t& duplicated = to == from ? counts->looped_back : counts->duplicated;
+        uint32_t& reordered = to == from ? counts->looped_back : counts->reordered;
+        // The previous report, if it was held back, now arrives after this one.
+        std::vector<uint8_t> late;
+        late.swap(heads[from].held[to]);
+        if (rand() % 100 < scenario.drop_percent) {
+            counts->dropped++;
+        } else if (late.empty() && rand() % 100 < scenario.reorder_percent) {
+            heads[from].held[to].assign(data, data + sizeof(packet));
+            reordered++;
+        } else {
+            sendTo(receiver, data, sizeof(packet), counts);
+            if (rand() % 100 < scenario.duplicate_percent) {
+                sendTo(receiver, data, sizeof(packet), counts);
+                duplicated++;
+            }
+        }
+        if (!late.empty()) {
+            sendTo(receiver, late.data(), late.size(), counts);
+        }
+    }
+}
+
+// Hands whatever arrived on the head's socket to its PeerProtocol.
+static void drain(Head& head, uint32_t now) {
+    uint8_t data[64];
+    for (;;) {
+        ssize_t length = recv(head.socket, data, sizeof(data), 0);
+        if (length < 0) {
+            CHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+            return;
+        }
+        head.protocol.receive(data, length, now);
+    }
+}
+
+static const Zone* findZone(const ZoneTable& zones, uint32_t id) {
+    for (uint8_t i = 0; i < zones.size(); i++) {
+        if (zones[i].id == id) {
+            return &zones[i];
+        }
+    }
+    return nullptr;
+}
+
+// Whether every head's table holds every head's current temperature.
+static bool converged(const Head* heads) {
+    for (uint8_t to = 0; to < HEAD_COUNT; to++) {
+        for (uint8_t from = 0; from < HEAD_COUNT; from++) {
+            const Zone* zone = findZone(heads[to].zones, heads[from].protocol.getSender());
+            if (zone == nullptr || fabsf(zone->temperature_current - heads[from].temperature) > 0.001f) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// One step of every booted head: read what arrived, then report if needed.
+// Each head's temperature rises a hundredth with a chance of change_percent.
+static void step(const Scenario& scenario, Head* heads, uint32_t now, int change_percent,
+                 Counts* counts) {
+    for (uint8_t i = 0; i < HEAD_COUNT; i++) {
+        Head& head = heads[i];
+        if (!head.booted) {
+            continue;
+        }
+        drain(head, now);
+        if (rand() % 100 < change_percent) {
+            head.temperature = roundf(head.temperature * 100 + 1) / 100;
+        }
+
+        PeerPacket packet;
+        if (head.protocol.buildReport(true, LOW, HIGH, head.temperature, now, &packet)) {
+            broadcast(scenario, heads, i, packet, counts);
+            head.protocol.onSent(packet, now);
+            // Heads ignore their own broadcasts, so add this head's zone here.
+            head.zones.update(head.protocol.getSender(), LOW, HIGH, head.temperature, 1, now);
+        }
+    }
+}
+
+// Steps until converged or until limit_ms have passed. Returns the time it
+// took, or limit_ms if it didn't converge.
+static uint32_t runUntilConverged(const Scenario& scenario, Head* heads, uint32_t* now,
+                                  uint32_t limit_ms, Counts* counts) {
+    uint32_t start = *now;
+    while (*now - start < limit_ms) {
+        step(scenario, heads, *now, 0, counts);
+        // Let the receivers read this step's reports before checking.
+        for (uint8_t i = 0; i < HEAD_COUNT; i++) {
+            drain(heads[i], *now);
+        }
+        if (converged(heads)) {
+            return *now - start;
+        }
+        *now += STEP_MS;
+    }
+    return limit_ms;
+}
+
+static void run(const Scenario& scenario) {
+    srand(1);
+    Counts counts;
+    Head heads[HEAD_COUNT];
+    std::vector<float> last_heard(HEAD_COUNT * HEAD_COUNT, 0);
+    for (uint8_t i = 0; i < HEAD_COUNT; i++) {
+        Head& head = heads[i];
+        head.socket = openSocket(&head.address);
+        head.protocol.setGroup(GROUP);
+        head.protocol.setSender(ZoneTable::internId("head_" + std::to_string(i)));
+        head.protocol.setReportCallback(
+            [&head, &heads, &counts, &last_heard, i](uint32_t sender,
+                                                      bool,
+                                                      float temperature_low,
+                                                      float temperature_high,
+                                                      float temperature_current,
+                                                      float weight) {
+                for (uint8_t from = 0; from < HEAD_COUNT; from++) {
+                    if (heads[from].protocol.getSender() != sender) {
+                        continue;
+                    }
+                    // Temperatures only ever rise, an older report is lower.
+                    float& last = last_heard[i * HEAD_COUNT + from];
+                    if (temperature_current < last) {
+                        counts.regressions++;
+                    }
+                    last = temperature_current;
+                }
+                head.zones.update(sender, temperature_low, temperature_high,
+                    temperature_current, weight, 0);
+            });
+    }
+
+    // Staggered boot.
+    uint32_t now = 0;
+    for (uint8_t i = 0; i < HEAD_COUNT; i++) {
+        heads[i].booted = true;
+        for (uint32_t until = now + BOOT_INTERVAL_MS; now < until; now += STEP_MS) {
+            step(scenario, heads, now, 0, &counts);
+        }
+    }
+    uint32_t boot_ms = runUntilConverged(scenario, heads, &now, SETTLE_MS, &counts);
+
+    // An hour of rising temperatures, a change every 20 seconds per head on
+    // average.
+    auto start = std::chrono::steady_clock::now();
+    uint32_t delivered = counts.delivered;
+    for (uint32_t until = now + CHURN_MS; now < until; now += STEP_MS) {
+        step(scenario, heads, now, 5, &counts);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    double ns_per_report = elapsed.count() / (counts.delivered - delivered);
+    uint32_t settle_ms = runUntilConverged(scenario, heads, &now, SETTLE_MS, &counts);
+
+    uint32_t lost = 0;
+    uint32_t out_of_order = 0;
+    uint32_t still_held = 0;
+    for (uint8_t i = 0; i < HEAD_COUNT; i++) {
+        Head& head = heads[i];
+        for (uint8_t to = 0; to < HEAD_COUNT; to++) {
+            if (to != i && !head.held[to].empty()) {
+                still_held++;
+            }
+        }
+        lost += head.protocol.getPacketsLost();
+        out_of_order += head.protocol.getPacketsOutOfOrder();
+        close(head.socket);
+    }
+    printf("%-26s converged %6u ms after boot, %6u ms after last change"
+        "  lost %5u  out of order %5u  %.0f ns/report over loopback\n",
+        scenario.name, boot_ms, settle_ms, lost, out_of_order, ns_per_report);
+
+    CHECK(boot_ms < SETTLE_MS);
+    CHECK(settle_ms < SETTLE_MS);
+    CHECK_EQ(counts.regressions, 0u);
+    // Every duplicate and every overtaken report that arrived is dropped,
+    // and nothing else is.
+    CHECK_EQ(out_of_order, counts.duplicated + counts.reordered - still_held);
+    if (scenario.drop_percent == 0 && scenario.reorder_percent == 0) {
+        CHECK_EQ(lost, 0u);
+        // Every report arrives as soon as it's sent.
+        CHECK_EQ(boot_ms, 0u);
+        CHECK_EQ(settle_ms, 0u);
+    } else {
+        // Dropped and overtaken reports are counted lost when a later one
+        // arrives.
+        CHECK(lost > 0);
+        CHECK(lost <= counts.dropped + counts.reordered);
+    }
+}
+
+// Sequence handling, without the sockets.
+static void checkSequence() {
+    PeerProtocol sender;
+    sender.setGroup(GROUP);
+    sender.setSender(1);
+    PeerProtocol receiver;
+    receiver.setGroup(GROUP);
+    receiver.setSender(2);
+    float heard = NAN;
+    receiver.setReportCallback(
+        [&heard](uint32_t, bool, float, float, float temperature_current, float) {
+            heard = temperature_current;
+        });
+
+    uint32_t now = 1000;
+    PeerPacket first;
+    CHECK(sender.buildReport(true, LOW, HIGH, 21, now, &first));
+    sender.onSent(first, now);
+    PeerPacket second;
+    CHECK(sender.buildReport(true, LOW, HIGH, 22, now, &second));
+    sender.onSent(second, now);
+    CHECK_EQ(second.sequence, first.sequence + 1);
+
+    // Nothing changed and the heartbeat isn't due.
+    PeerPacket unchanged;
+    CHECK(!sender.buildReport(true, LOW, HIGH, 22, now + 1000, &unchanged));
+
+    const uint8_t* first_data = reinterpret_cast<const uint8_t*>(&first);
+    const uint8_t* second_data = reinterpret_cast<const uint8_t*>(&second);
+    CHECK(receiver.receive(second_data, sizeof(second), now));
+    CHECK_EQ(heard, 22);
+    // A duplicate, then the report it overtook.
+    CHECK(!receiver.receive(second_data, sizeof(second), now));
+    CHECK(!receiver.receive(first_data, sizeof(first), now + 10));
+    CHECK_EQ(heard, 22);
+    CHECK_EQ(receiver.getPacketsOutOfOrder(), 2u);
+
+    // Own reports and other groups are ignored without counting them.
+    CHECK(!sender.receive(second_data, sizeof(second), now));
+    PeerProtocol other_group;
+    other_group.setGroup(GROUP + 1);
+    CHECK(!other_group.receive(second_data, sizeof(second), now));
+    CHECK_EQ(sender.getPacketsOutOfOrder(), 0u);
+    CHECK_EQ(other_group.getPacketsOutOfOrder(), 0u);
+    // Nor is anything that isn't a report.
+    CHECK(!receiver.receive(second_data, sizeof(second) - 1, now));
+
+    // A gap counts the reports in it as lost, across the sequence wrapping.
+    PeerPacket later = second;
+    later.sequence = second.sequence + 3;
+    later.temperature_current = 2300;
+    CHECK(receiver.receive(reinterpret_cast<const uint8_t*>(&later), sizeof(later), now));
+    CHECK_EQ(receiver.getPacketsLost(), 2u);
+    PeerPacket wrapped = later;
+    wrapped.sequence = 65535;
+    CHECK(receiver.receive(reinterpret_cast<const uint8_t*>(&wrapped), sizeof(wrapped), now + 5000));
+    wrapped.sequence = 0;
+    CHECK(receiver.receive(reinterpret_cast<const uint8_t*>(&wrapped), sizeof(wrapped), now + 5000));
+    CHECK_EQ(receiver.getPacketsLost(), 2u);
+
+    // A restarted head counts from 0 again, and is heard once it's back.
+    PeerProtocol restarted;
+    restarted.setGroup(GROUP);
+    restarted.setSender(1);
+    PeerPacket rebooted;
+    CHECK(restarted.buildReport(true, LOW, HIGH, 19, now + 30000, &rebooted));
+    CHECK_EQ(rebooted.sequence, 0);
+    CHECK(receiver.receive(reinterpret_cast<const uint8_t*>(&rebooted), sizeof(rebooted), now + 30000));
+    CHECK_EQ(heard, 19);
+}
+
+static void benchmarkEncodeDecode() {
+    PeerProtocol sender;
+    sender.setGroup(GROUP);
+    sender.setSender(1);
+    PeerProtocol receiver;
+    receiver.setGroup(GROUP);
+    receiver.setSender(2);
+    uint32_t accepted = 0;
+    receiver.setReportCallback([&accepted](uint32_t, bool, float, float, float, float) {
+        accepted++;
+    });
+
+    const unsigned ITERATIONS = 1000000;
+    double ns = nanosecondsPerIteration(ITERATIONS, [&](unsigned i) {
+        PeerPacket packet;
+        if (sender.buildReport(true, LOW, HIGH, 20 + (i % 400) / 100.0f, i, &packet)) {
+            sender.onSent(packet, i);
+            receiver.receive(reinterpret_cast<const uint8_t*>(&packet), sizeof(packet), i);
+        }
+    });
+    printf("build and accept a report: %.1f ns\n", ns);
+    CHECK_EQ(accepted, ITERATIONS);
+}
+
+int main() {
+    checkSequence();
+    benchmarkEncodeDecode();
+
+    static const Scenario SCENARIOS[] = {
+        {"clean", 0, 0, 0},
+        {"20% lost", 20, 0, 0},
+        {"duplicated and reordered", 0, 10, 10},
+    };
+    for (const Scenario& scenario : SCENARIOS) {
+        run(scenario);
+    }
+    return checkResult();
+}
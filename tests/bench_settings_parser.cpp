@@ -0,0 +1,87 @@
+// Micro-benchmark of HeatpumpSettingsParser against the strcmp chains it
+// replaced. The HeatPump library hands out pointers into its own *_MAP
+// tables, which are mirrored here so the parser's pointer cache is
+// exercised the way it is on the device.
+
+#include "HeatpumpSettings.h"
+#include "check.h"
+
+static const char* POWER_MAP[2] = {"OFF", "ON"};
+static const char* MODE_MAP[5] = {"HEAT", "DRY", "COOL", "FAN", "AUTO"};
+static const char* FAN_MAP[6] = {"AUTO", "QUIET", "1", "2", "3", "4"};
+static const char* VANE_MAP[7] = {"AUTO", "1", "2", "3", "4", "5", "SWING"};
+static const char* WIDEVANE_MAP[7] = {"<<", "<", "|", ">", ">>", "<>", "SWING"};
+
+static const unsigned ITERATIONS = 1000000;
+
+static heatpumpSettings librarySettings(unsigned i) {
+    heatpumpSettings settings{};
+    settings.power = POWER_MAP[1];
+    settings.mode = MODE_MAP[2];
+    settings.temperature = 21.5;
+    settings.fan = FAN_MAP[i % 64 == 0 ? 3 : 0];
+    settings.vane = VANE_MAP[6];
+    settings.wideVane = WIDEVANE_MAP[2];
+    settings.connected = true;
+    return settings;
+}
+
+// The string comparisons used before the enum model, one field's worth.
+static int strcmpChain(const char* raw, const char* const* names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(raw, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void checkParse() {
+    HeatpumpSettingsParser parser;
+    for (unsigned i = 1; i < 3; i++) {
+        HeatpumpSettingsModel model = parser.parse(librarySettings(i));
+        CHECK(model.power == HeatpumpPowerSetting::ON);
+        CHECK(model.mode == HeatpumpModeSetting::COOL);
+        CHECK(model.fan == HeatpumpFanSetting::AUTO);
+        CHECK(model.vane == HeatpumpVaneSetting::SWING);
+        CHECK(model.wideVane == HeatpumpWideVaneSetting::CENTER);
+    }
+
+    heatpumpSettings unknown = librarySettings(0);
+    unknown.mode = "BOGUS";
+    unknown.fan = nullptr;
+    HeatpumpSettingsModel model = parser.parse(unknown);
+    CHECK(model.mode == HeatpumpModeSetting::UNKNOWN);
+    CHECK(model.fan == HeatpumpFanSetting::UNKNOWN);
+}
+
+int main() {
+    checkParse();
+
+    volatile int sink = 0;
+    double chain_ns = nanosecondsPerIteration(ITERATIONS, [&](unsigned i) {
+        heatpumpSettings settings = librarySettings(i);
+        sink = sink + strcmpChain(settings.power, POWER_MAP, 2) +
+            strcmpChain(settings.mode, MODE_MAP, 5) +
+            strcmpChain(settings.fan, FAN_MAP, 6) +
+            strcmpChain(settings.vane, VANE_MAP, 7) +
+            strcmpChain(settings.wideVane, WIDEVANE_MAP, 7);
+    });
+
+    HeatpumpSettingsParser parser;
+    double parser_ns = nanosecondsPerIteration(ITERATIONS, [&](unsigned i) {
+        HeatpumpSettingsModel model = parser.parse(librarySettings(i));
+        sink = sink + static_cast<int>(model.fan);
+    });
+
+    double cold_ns = nanosecondsPerIteration(ITERATIONS, [&](unsigned i) {
+        HeatpumpSettingsParser cold;
+        HeatpumpSettingsModel model = cold.parse(librarySettings(i));
+        sink = sink + static_cast<int>(model.fan);
+    });
+
+    printf("strcmp chains: %.1f ns/parse\n", chain_ns);
+    printf("parser, warm:  %.1f ns/parse\n", parser_ns);
+    printf("parser, cold:  %.1f ns/parse\n", cold_ns);
+    return checkResult();
+}
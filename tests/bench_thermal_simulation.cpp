@@ -0,0 +1,297 @@
+// Week long thermal simulation of managed dual point mode on a multisplit.
+//
+// Three rooms, each with a head running TwoPointHeatPump in managed mode and
+// a ZoneConsistencyController, exchange zone reports every minute as the
+// peer link does. Each head talks CN105 to an emulated unit from stubs/, on
+// the simulated clock, so a week runs in seconds. The simulation closes the
+// loop: rooms lose heat to a daily outdoor temperature cycle and gain it
+// from sun and occupancy, and each unit's own thermostat runs its compressor
+// towards the setpoint it was given, heating or cooling the room. The
+// outdoor unit can only heat or cool at a time, so a head asking for the
+// other mode while another one runs is blocked.
+//
+// Reported per scenario, summed over the rooms: degree hours outside the
+// setpoints, hours more than the unit's hysteresis outside them, hours blocked by the other heads, HEAT/COOL
+// switches, compressor starts and frequency hours as an energy proxy.
+
+#include "ZoneConsistencyController.h"
+#include "check.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+static const float LOW = 20;
+static const float HIGH = 24;
+
+static const uint32_t UPDATE_INTERVAL_MS = 500;
+static const uint32_t REPORT_INTERVAL_MS = 60 * 1000;
+static const uint32_t PHYSICS_STEP_MS = 10 * 1000;
+static const uint32_t DAY_MS = 24 * 60 * 60 * 1000;
+static const uint32_t SIMULATED_MS = 7 * DAY_MS;
+static const uint8_t ROOM_COUNT = 3;
+
+// Time constant of heat loss to outdoors, in hours.
+static const float ENVELOPE_HOURS = 12;
+// Heating or cooling rate at full compressor frequency, in degrees per hour.
+static const float CAPACITY = 4;
+static const int MIN_FREQUENCY = 20;
+static const int MAX_FREQUENCY = 100;
+// The unit's own thermostat: it starts the compressor this far on the wrong
+// side of its setpoint, and stops it this far past. In between the frequency
+// follows a PI controller, in Hz per degree and per degree hour.
+static const float UNIT_HYSTERESIS = 0.5;
+static const float PROPORTIONAL_GAIN = 40;
+static const float INTEGRAL_GAIN = 40;
+// A room held at one of the setpoints sits on the edge of the band, so time
+// only counts as outside it beyond the unit's own hysteresis.
+static const float BAND_TOLERANCE = UNIT_HYSTERESIS;
+
+struct Room {
+    // Peak gain from the sun, around midday, in degrees per hour.
+    float solar_gain;
+    // Gain while occupied, in degrees per hour.
+    float occupied_gain;
+    uint8_t occupied_from;
+    uint8_t occupied_until;
+};
+
+// A living room occupied in the evening, a sunny home office occupied by day
+// and a shaded bedroom occupied at night.
+static const Room ROOMS[ROOM_COUNT] = {
+    {0.3f, 0.8f, 17, 23},
+    {1.0f, 0.5f, 8, 17},
+    {0.0f, 0.3f, 22, 24},
+};
+
+struct Scenario {
+    const char* name;
+    // Daily mean outdoor temperature and the swing either side of it.
+    float outdoor_mean;
+    float outdoor_swing;
+    // Scales the sun.
+    float sunshine;
+    // Whether the weather only ever calls for one of HEAT and COOL.
+    bool one_mode;
+};
+
+struct Outcome {
+    float degree_hours = 0;
+    float hours_outside = 0;
+    float hours_blocked = 0;
+    uint32_t mode_switches = 0;
+    uint32_t compressor_starts = 0;
+    float frequency_hours = 0;
+};
+
+// One indoor unit, the head controlling it and the room it conditions.
+struct Head {
+    Head() : hp(LOW, HIGH, true) {}
+
+    TwoPointHeatPump hp;
+    ZoneConsistencyController zones;
+    float temperature = 0;
+    bool running = false;
+    int frequency = 0;
+    // Integral of the thermostat's error while running, in degree hours.
+    float integral = 0;
+    // +1 while the unit is set to heat, -1 to cool, 0 otherwise.
+    int direction = 0;
+    int last_direction = 0;
+    uint32_t next_update = 0;
+};
+
+static float outdoorTemperature(const Scenario& scenario, float hour) {
+    // Warmest at 15:00.
+    return scenario.outdoor_mean +
+        scenario.outdoor_swing * cosf(2 * (float) M_PI * (hour - 15) / 24);
+}
+
+static float roomGain(const Scenario& scenario, const Room& room, float hour) {
+    float gain = 0;
+    if (hour > 7 && hour < 17) {
+        gain += scenario.sunshine * room.solar_gain * sinf((float) M_PI * (hour - 7) / 10);
+    }
+    if (hour >= room.occupied_from && hour < room.occupied_until) {
+        gain += room.occupied_gain;
+    }
+    return gain;
+}
+
+// What the unit is set to, as a direction.
+static int unitDirection(const EmulatedUnit& unit) {
+    if (strcmp(unit.power, "ON") != 0) {
+        return 0;
+    }
+    if (strcmp(unit.mode, "HEAT") == 0) {
+        return 1;
+    }
+    if (strcmp(unit.mode, "COOL") == 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Runs each unit's thermostat and moves the rooms on by elapsed_ms.
+static void stepRooms(const Scenario& scenario, Head* heads, uint32_t now, uint32_t elapsed_ms,
+                      Outcome* outcome) {
+    float hours = elapsed_ms / 3600000.0f;
+    float hour = (now % DAY_MS) / 3600000.0f;
+    float outdoor = outdoorTemperature(scenario, hour);
+
+    // The outdoor unit heats or cools for whichever head is already running.
+    int outdoor_direction = 0;
+    for (uint8_t i = 0; i < ROOM_COUNT; i++) {
+        if (heads[i].running && heads[i].direction != 0) {
+            outdoor_direction = heads[i].direction;
+            break;
+        }
+    }
+
+    for (uint8_t i = 0; i < ROOM_COUNT; i++) {
+        Head& head = heads[i];
+        EmulatedUnit& unit = head.hp.getUnit();
+        head.direction = unitDirection(unit);
+        if (head.direction != 0) {
+            if (head.last_direction != 0 && head.direction != head.last_direction) {
+                outcome->mode_switches++;
+            }
+            head.last_direction = head.direction;
+        }
+
+        // How far the room is on the wrong side of the unit's setpoint.
+        float error = head.direction * (unit.temperature - head.temperature);
+        bool wanted = head.direction != 0 &&
+            (head.running ? error > -UNIT_HYSTERESIS : error >= UNIT_HYSTERESIS);
+        bool blocked = wanted && outdoor_direction != 0 && outdoor_direction != head.direction;
+        if (blocked) {
+            outcome->hours_blocked += hours;
+        }
+        bool running = wanted && !blocked;
+        if (running && !head.running) {
+            outcome->compressor_starts++;
+        }
+        if (running && outdoor_direction == 0) {
+            outdoor_direction = head.direction;
+        }
+        head.running = running;
+        if (running) {
+            head.integral = std::min(2.0f, std::max(0.0f, head.integral + error * hours));
+            float frequency = MIN_FREQUENCY + PROPORTIONAL_GAIN * error + INTEGRAL_GAIN * head.integral;
+            head.frequency = std::min(MAX_FREQUENCY, std::max(MIN_FREQUENCY, (int) frequency));
+        } else {
+            head.frequency = 0;
+        }
+
+        float conditioning = head.direction * CAPACITY * head.frequency / MAX_FREQUENCY;
+        head.temperature += hours * ((outdoor - head.temperature) / ENVELOPE_HOURS +
+            roomGain(scenario, ROOMS[i], hour) + conditioning);
+
+        float outside_by = std::max(LOW - head.temperature, head.temperature - HIGH);
+        if (outside_by > 0) {
+            outcome->degree_hours += outside_by * hours;
+        }
+        if (outside_by > BAND_TOLERANCE) {
+            outcome->hours_outside += hours;
+        }
+        outcome->frequency_hours += head.frequency * hours;
+
+        // The CN105 room temperature has half degree resolution.
+        unit.room_temperature = roundf(head.temperature * 2) / 2;
+        unit.operating = running;
+        unit.compressor_frequency = head.frequency;
+    }
+}
+
+static Outcome simulate(const Scenario& scenario) {
+    simulated_millis = 0;
+    Head heads[ROOM_COUNT];
+    for (uint8_t i = 0; i < ROOM_COUNT; i++) {
+        Head& head = heads[i];
+        // Inside the band, on the side the weather pulls towards.
+        head.temperature = scenario.outdoor_mean < LOW ? LOW + 1 : HIGH - 1;
+        // Off until the head decides, so its first choice isn't a switch.
+        head.hp.getUnit().power = "OFF";
+        head.hp.getUnit().room_temperature = head.temperature;
+        head.zones.setHeatpumpController(&head.hp);
+        CHECK(head.hp.connect(nullptr));
+    }
+
+    Outcome outcome;
+    uint32_t last_physics = 0;
+    uint32_t next_physics = PHYSICS_STEP_MS;
+    uint32_t next_report = REPORT_INTERVAL_MS;
+    while (millis() < SIMULATED_MS) {
+        uint32_t now = millis();
+        if (now >= next_physics) {
+            stepRooms(scenario, heads, now, now - last_physics, &outcome);
+            last_physics = now;
+            next_physics = now + PHYSICS_STEP_MS;
+        }
+
+        if (now >= next_report) {
+            // Every head hears every zone, its own included.
+            for (uint8_t from = 0; from < ROOM_COUNT; from++) {
+                for (uint8_t to = 0; to < ROOM_COUNT; to++) {
+                    heads[to].zones.zoneUpdate(
+                        from + 1, true, LOW, HIGH, heads[from].temperature);
+                }
+            }
+            next_report = now + REPORT_INTERVAL_MS;
+        }
+
+        uint32_t next_event = std::min(next_physics, next_report);
+        for (uint8_t i = 0; i < ROOM_COUNT; i++) {
+            Head& head = heads[i];
+            if (millis() >= head.next_update) {
+                head.next_update = millis() + UPDATE_INTERVAL_MS;
+                head.hp.sync();
+                if (head.hp.getSettings().isValid()) {
+                    head.hp.updateIfChangesPending();
+                }
+            }
+            next_event = std::min(next_event, head.next_update);
+        }
+
+        // A blocking write may have moved the clock past the next event.
+        if (millis() < next_event) {
+            simulated_millis = next_event;
+        }
+    }
+    return outcome;
+}
+
+int main() {
+    static const Scenario SCENARIOS[] = {
+        {"winter", 2, 4, 0.3f, true},
+        {"shoulder season", 15, 7, 1.0f, false},
+        {"summer", 28, 5, 1.0f, true},
+    };
+
+    printf("zone arbitration: %s\n", ZoneArbitration::name());
+    for (const Scenario& scenario : SCENARIOS) {
+        auto start = std::chrono::steady_clock::now();
+        Outcome outcome = simulate(scenario);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        printf("%-16s outside %5.1f degree h  %5.1f h  blocked %5.1f h  switches %3u"
+            "  compressor starts %4u  frequency %6.0f Hz h  (%.1f s)\n",
+            scenario.name, outcome.degree_hours, outcome.hours_outside,
+            outcome.hours_blocked, outcome.mode_switches, outcome.compressor_starts,
+            outcome.frequency_hours, elapsed.count());
+
+        // The rooms are kept within their setpoints, the heads agree on the
+        // outdoor unit's mode, and the compressors don't short cycle.
+        float room_hours = ROOM_COUNT * SIMULATED_MS / 3600000.0f;
+        CHECK(outcome.hours_outside < room_hours * 0.02f);
+        CHECK(outcome.hours_blocked < room_hours * 0.01f);
+        CHECK(outcome.compressor_starts <= ROOM_COUNT * (SIMULATED_MS / DAY_MS) * 6);
+        if (scenario.one_mode) {
+            CHECK_EQ(outcome.mode_switches, 0u);
+        } else {
+            CHECK(outcome.mode_switches > 0);
+        }
+    }
+    return checkResult();
+}
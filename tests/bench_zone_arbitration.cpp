@@ -0,0 +1,258 @@
+// Multizone simulation benchmark of the arbitration strategies.
+//
+// A day on a multisplit is simulated minute by minute. Sunny zones drift
+// warmer and shaded zones cooler, and each strategy decides whether the
+// outdoor unit heats or cools, as ZoneConsistencyController does. A zone
+// on the served side is conditioned back towards its setpoints; the other
+// zones wait. Reported per strategy: degree hours spent outside the
+// setpoints, the same weighted by zone_weight, the longest stretch any one
+// zone waited and the number of heat/cool switches, plus the cost of a
+// demand() call. A second scenario keeps both sides demanding for several
+// arbitration slices, where the strategies differ in who gets served.
+
+#include "ZoneArbitration.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+static const uint32_t STEP_MS = 60 * 1000;
+static const uint32_t SIMULATED_MS = 24 * 60 * 60 * 1000;
+static const float DEMAND_THRESHOLD = 0.1; // as in ZoneConsistencyController
+static const float CONDITIONING_RATE = 4.0; // degrees per hour
+static const float HYSTERESIS = 0.5;
+
+struct SimulatedZone {
+    float temperature;
+    float low;
+    float high;
+    float drift; // degrees per hour
+    float weight;
+    uint32_t outside_since;
+    bool outside;
+};
+
+struct Outcome {
+    float degree_hours = 0;
+    float weighted_degree_hours = 0;
+    uint32_t longest_wait_ms = 0;
+    uint32_t switches = 0;
+};
+
+static float outsideBy(const SimulatedZone& zone) {
+    if (zone.temperature < zone.low) {
+        return zone.low - zone.temperature;
+    }
+    if (zone.temperature > zone.high) {
+        return zone.temperature - zone.high;
+    }
+    return 0;
+}
+
+static void makeZones(SimulatedZone* zones, uint8_t count) {
+    srand(count);
+    for (uint8_t i = 0; i < count; i++) {
+        bool sunny = i % 3 == 0;
+        zones[i].low = 20 + (rand() % 3) * 0.5f;
+        zones[i].high = zones[i].low + 3;
+        zones[i].temperature = zones[i].low + 1.5f;
+        zones[i].drift = sunny ? 0.8f + (rand() % 5) * 0.1f : -0.6f - (rand() % 5) * 0.1f;
+        zones[i].weight = 0.5f + (rand() % 4) * 0.5f;
+        zones[i].outside = false;
+        zones[i].outside_since = 0;
+    }
+}
+
+template<typename Strategy>
+static Outcome simulate(uint8_t count) {
+    SimulatedZone zones[ZoneTable::CAPACITY];
+    makeZones(zones, count);
+
+    Strategy strategy;
+    ZoneTable table;
+    Outcome outcome;
+    int8_t side = 0;
+    float hours = STEP_MS / 3600000.0f;
+    for (uint32_t now = 0; now < SIMULATED_MS; now += STEP_MS) {
+        for (uint8_t i = 0; i < count; i++) {
+            table.update(i + 1, zones[i].low, zones[i].high, zones[i].temperature,
+                zones[i].weight, now);
+        }
+
+        float demand = strategy.demand(table, now);
+        int8_t next = demand < -DEMAND_THRESHOLD ? -1 : (demand > DEMAND_THRESHOLD ? 1 : side);
+        if (side != 0 && next != side) {
+            outcome.switches++;
+        }
+        side = next;
+
+        for (uint8_t i = 0; i < count; i++) {
+            SimulatedZone& zone = zones[i];
+            float change = zone.drift;
+            if (side < 0 && zone.temperature < zone.low + HYSTERESIS) {
+                change += CONDITIONING_RATE;
+            } else if (side > 0 && zone.temperature > zone.high - HYSTERESIS) {
+                change -= CONDITIONING_RATE;
+            }
+            zone.temperature += change * hours;
+
+            float outside = outsideBy(zone);
+            outcome.degree_hours += outside * hours;
+            outcome.weighted_degree_hours += zone.weight * outside * hours;
+            if (outside > 0 && !zone.outside) {
+                zone.outside = true;
+                zone.outside_since = now;
+            } else if (outside == 0 && zone.outside) {
+                zone.outside = false;
+                outcome.longest_wait_ms = std::max(outcome.longest_wait_ms, now - zone.outside_since);
+            }
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (zones[i].outside) {
+            outcome.longest_wait_ms = std::max(outcome.longest_wait_ms, SIMULATED_MS - zones[i].outside_since);
+        }
+    }
+    return outcome;
+}
+
+template<typename Strategy>
+static void report(uint8_t count) {
+    Outcome outcome = simulate<Strategy>(count);
+    printf("  %-16s %8.1f %9.1f %10.0f %9u\n", Strategy::name(), outcome.degree_hours,
+        outcome.weighted_degree_hours, outcome.longest_wait_ms / 60000.0, outcome.switches);
+    CHECK(outcome.degree_hours >= 0);
+}
+
+// Time a multisplit spends serving each side while both keep demanding it.
+struct Service {
+    uint32_t served_ms[2] = {}; // heat, cool
+    uint32_t switches = 0;
+    // Longest stretch a side with demand went unserved.
+    uint32_t longest_wait_ms = 0;
+};
+
+static const uint32_t SUSTAINED_MS = 8 * TimeSlicedArbitration::SLICE_MS;
+
+// A cold zone and a warmer one that stay outside their setpoints for several
+// slices, as when the multisplit can't catch up with either: serving a side
+// doesn't satisfy it before the slice is over.
+template<typename Strategy>
+static Service sustainedDemand() {
+    Strategy strategy;
+    ZoneTable table;
+    Service service;
+    int8_t side = 0;
+    uint32_t waiting_since[2] = {0, 0};
+    for (uint32_t now = 0; now < SUSTAINED_MS; now += STEP_MS) {
+        table.update(1, 20, 23, 18, 1, now);
+        table.update(2, 20, 23, 26, 1, now);
+        float demand = strategy.demand(table, now);
+        int8_t next = demand < -DEMAND_THRESHOLD ? -1 : (demand > DEMAND_THRESHOLD ? 1 : side);
+        if (side != 0 && next != side) {
+            service.switches++;
+        }
+        side = next;
+
+        uint32_t end = now + STEP_MS;
+        for (uint8_t i = 0; i < 2; i++) {
+            if (side == (i == 0 ? -1 : 1)) {
+                service.served_ms[i] += STEP_MS;
+                waiting_since[i] = end;
+            } else {
+                service.longest_wait_ms = std::max(service.longest_wait_ms, end - waiting_since[i]);
+            }
+        }
+    }
+    return service;
+}
+
+template<typename Strategy>
+static Service reportSustained() {
+    Service service = sustainedDemand<Strategy>();
+    printf("  %-16s %8.0f %8.0f %10.0f %9u\n", Strategy::name(),
+        service.served_ms[0] / 60000.0, service.served_ms[1] / 60000.0,
+        service.longest_wait_ms / 60000.0, service.switches);
+    return service;
+}
+
+// Both sides demand longer than a slice. Max delta serves the further zone
+// throughout and starves the other; time sliced alternates every slice, so
+// neither waits much longer than one.
+static void checkSustainedDemandBothSides() {
+    printf("heat and cool demand for %u minutes:  heat min  cool min  longest wait min  switches\n",
+        SUSTAINED_MS / 60000);
+    Service max_delta = reportSustained<MaxDeltaArbitration>();
+    reportSustained<SumOfDeficitsArbitration>();
+    Service time_sliced = reportSustained<TimeSlicedArbitration>();
+
+    CHECK_EQ(max_delta.served_ms[0], 0u);
+    CHECK_EQ(max_delta.switches, 0u);
+    CHECK_EQ(max_delta.longest_wait_ms, SUSTAINED_MS);
+
+    uint32_t slices = SUSTAINED_MS / TimeSlicedArbitration::SLICE_MS;
+    CHECK(time_sliced.switches >= slices - 1);
+    CHECK(time_sliced.longest_wait_ms <= TimeSlicedArbitration::SLICE_MS + STEP_MS);
+    for (uint8_t i = 0; i < 2; i++) {
+        CHECK(time_sliced.served_ms[i] >= SUSTAINED_MS / 2 - TimeSlicedArbitration::SLICE_MS);
+    }
+}
+
+template<typename Strategy>
+static double demandCost(const ZoneTable& table) {
+    Strategy strategy;
+    volatile float sink = 0;
+    return nanosecondsPerIteration(1000000, [&](unsigned i) {
+        sink = sink + strategy.demand(table, i);
+    });
+}
+
+// The strategies against brute force over the zones.
+static void checkDemand() {
+    srand(1);
+    ZoneTable table;
+    for (uint8_t i = 0; i < ZoneTable::CAPACITY; i++) {
+        float low = 19 + rand() % 4;
+        table.update(i + 1, low, low + 3, 15 + (rand() % 140) * 0.1f, 0.5f + (rand() % 4) * 0.5f, i);
+    }
+
+    float max_heat = 0;
+    float max_cool = 0;
+    float weighted_sum = 0;
+    for (uint8_t i = 0; i < table.size(); i++) {
+        float delta = zoneDelta(table[i]);
+        max_heat = std::min(max_heat, delta);
+        max_cool = std::max(max_cool, delta);
+        weighted_sum += table[i].weight * delta;
+    }
+
+    MaxDeltaArbitration max_delta;
+    SumOfDeficitsArbitration sum_of_deficits;
+    float expected = max_cool > -max_heat ? max_cool : max_heat;
+    CHECK(max_delta.demand(table, 0) == expected);
+    CHECK(fabsf(sum_of_deficits.demand(table, 0) - weighted_sum) < 0.01f);
+}
+
+int main() {
+    checkDemand();
+
+    static const uint8_t ZONE_COUNTS[] = {4, 16, 64};
+    for (uint8_t count : ZONE_COUNTS) {
+        printf("%u zones, 24 hours:  degree h  weighted  longest wait min  switches\n", count);
+        report<MaxDeltaArbitration>(count);
+        report<SumOfDeficitsArbitration>(count);
+        report<TimeSlicedArbitration>(count);
+    }
+    checkSustainedDemandBothSides();
+
+    ZoneTable table;
+    for (uint8_t i = 0; i < ZoneTable::CAPACITY; i++) {
+        table.update(i + 1, 20, 23, 18 + (i % 8), 1, i);
+    }
+    printf("demand() with %u zones: max delta %.1f ns, sum of deficits %.1f ns, time sliced %.1f ns\n",
+        ZoneTable::CAPACITY,
+        demandCost<MaxDeltaArbitration>(table),
+        demandCost<SumOfDeficitsArbitration>(table),
+        demandCost<TimeSlicedArbitration>(table));
+    return checkResult();
+}
@@ -0,0 +1,203 @@
+// 64 zone benchmark of ZoneTable against a brute force table.
+//
+// The brute force table finds zones with a linear scan and recomputes the
+// arbitration aggregates from every zone on each query, as the table did
+// before it kept them incrementally. Random reports, additions, removals
+// and expiries are applied to both, and every aggregate is compared after
+// each step. Then the cost of a report followed by the aggregate queries is
+// timed for both with the table full.
+
+#include "ZoneTable.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+class BruteForceTable {
+public:
+    void update(uint32_t id, float low, float high, float current, float weight, uint32_t now_ms) {
+        int index = find(id);
+        if (index < 0) {
+            if (size_ == ZoneTable::CAPACITY) {
+                removeAt(oldest());
+            }
+            index = size_++;
+        }
+        Zone& zone = zones_[index];
+        zone.id = id;
+        zone.updated_at = now_ms;
+        zone.temperature_low = low;
+        zone.temperature_high = high;
+        zone.temperature_current = current;
+        zone.weight = weight;
+        zone.delta = zoneDelta(zone);
+    }
+
+    bool remove(uint32_t id) {
+        int index = find(id);
+        if (index < 0) {
+            return false;
+        }
+        removeAt(index);
+        return true;
+    }
+
+    uint8_t expire(uint32_t now_ms, uint32_t max_age_ms) {
+        uint8_t removed = 0;
+        for (uint8_t i = 0; i < size_;) {
+            if (now_ms - zones_[i].updated_at > max_age_ms) {
+                removeAt(i);
+                removed++;
+            } else {
+                i++;
+            }
+        }
+        return removed;
+    }
+
+    bool oldestUpdate(uint32_t* updated_at) const {
+        if (size_ == 0) {
+            return false;
+        }
+        *updated_at = zones_[oldest()].updated_at;
+        return true;
+    }
+
+    float maxHeatDelta() const {
+        float result = 0;
+        for (uint8_t i = 0; i < size_; i++) {
+            result = std::min(result, zones_[i].delta);
+        }
+        return result;
+    }
+
+    float maxCoolDelta() const {
+        float result = 0;
+        for (uint8_t i = 0; i < size_; i++) {
+            result = std::max(result, zones_[i].delta);
+        }
+        return result;
+    }
+
+    float weightedDeltaSum() const {
+        float result = 0;
+        for (uint8_t i = 0; i < size_; i++) {
+            result += zones_[i].weight * zones_[i].delta;
+        }
+        return result;
+    }
+
+    uint8_t size() const { return size_; }
+
+private:
+    int find(uint32_t id) const {
+        for (uint8_t i = 0; i < size_; i++) {
+            if (zones_[i].id == id) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    uint8_t oldest() const {
+        uint8_t result = 0;
+        for (uint8_t i = 1; i < size_; i++) {
+            if (static_cast<int32_t>(zones_[i].updated_at - zones_[result].updated_at) < 0) {
+                result = i;
+            }
+        }
+        return result;
+    }
+
+    void removeAt(uint8_t index) {
+        zones_[index] = zones_[--size_];
+    }
+
+    Zone zones_[ZoneTable::CAPACITY];
+    uint8_t size_ = 0;
+};
+
+static const uint32_t ZONE_IDS = 96;
+
+static float randomTemperature() {
+    return 15 + (rand() % 140) * 0.1f;
+}
+
+static uint32_t zoneId(uint32_t zone) {
+    return zone * 2654435761UL;
+}
+
+template<typename Table>
+static void report(Table& table, uint32_t zone, float current, uint32_t now_ms) {
+    float low = 19 + (zone % 4);
+    table.update(zoneId(zone), low, low + 3, current, 0.5f + (zone % 4) * 0.5f, now_ms);
+}
+
+static void checkAgainstBruteForce() {
+    srand(64);
+    ZoneTable table;
+    BruteForceTable reference;
+    uint32_t now = 0;
+    for (uint32_t step = 0; step < 200000; step++) {
+        // Strictly increasing, so the least recently reporting zone is
+        // never a tie.
+        now += 1 + rand() % 1000;
+        uint32_t zone = rand() % ZONE_IDS;
+        int action = rand() % 100;
+        if (action < 90) {
+            float current = randomTemperature();
+            report(table, zone, current, now);
+            report(reference, zone, current, now);
+        } else if (action < 98) {
+            CHECK_EQ(table.remove(zoneId(zone)), reference.remove(zoneId(zone)));
+        } else {
+            uint32_t max_age = 20000 + rand() % 60000;
+            CHECK_EQ(table.expire(now, max_age), reference.expire(now, max_age));
+        }
+
+        CHECK_EQ(table.size(), reference.size());
+        CHECK_EQ(table.maxHeatDelta(), reference.maxHeatDelta());
+        CHECK_EQ(table.maxCoolDelta(), reference.maxCoolDelta());
+        CHECK(fabsf(table.weightedDeltaSum() - reference.weightedDeltaSum()) < 0.01f);
+        uint32_t oldest = 0;
+        uint32_t expected_oldest = 0;
+        CHECK_EQ(table.oldestUpdate(&oldest), reference.oldestUpdate(&expected_oldest));
+        CHECK_EQ(oldest, expected_oldest);
+        if (check_failures > 0) {
+            fprintf(stderr, "diverged at step %u\n", step);
+            return;
+        }
+    }
+}
+
+// A report from a random known zone, then every query arbitration and
+// expiry scheduling make.
+template<typename Table>
+static double reportCost() {
+    Table table;
+    srand(1);
+    uint32_t now = 0;
+    for (uint32_t zone = 0; zone < ZoneTable::CAPACITY; zone++) {
+        report(table, zone, randomTemperature(), ++now);
+    }
+    CHECK_EQ(table.size(), ZoneTable::CAPACITY);
+
+    volatile float sink = 0;
+    return nanosecondsPerIteration(2000000, [&](unsigned i) {
+        report(table, i % ZoneTable::CAPACITY, 15 + (i % 140) * 0.1f, ++now);
+        uint32_t oldest = 0;
+        table.oldestUpdate(&oldest);
+        sink = sink + table.maxHeatDelta() + table.maxCoolDelta() + table.weightedDeltaSum() + oldest;
+    });
+}
+
+int main() {
+    checkAgainstBruteForce();
+
+    double incremental_ns = reportCost<ZoneTable>();
+    double brute_force_ns = reportCost<BruteForceTable>();
+    printf("%u zones, report + queries: incremental %.1f ns, brute force %.1f ns\n",
+        ZoneTable::CAPACITY, incremental_ns, brute_force_ns);
+    return checkResult();
+}
@@ -0,0 +1,41 @@
+// Minimal assertion helpers shared by the host tests.
+
+#ifndef HOST_CHECK_H
+#define HOST_CHECK_H
+
+#include <chrono>
+#include <cstdio>
+
+static int check_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+// Returns the process exit code.
+inline int checkResult() {
+    if (check_failures > 0) {
+        fprintf(stderr, "%d checks failed\n", check_failures);
+        return 1;
+    }
+    return 0;
+}
+
+// Wall clock time of fn() in nanoseconds per iteration.
+template<typename F>
+double nanosecondsPerIteration(unsigned iterations, F fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+#endif
@@ -0,0 +1,23 @@
+// Host stand-in for the Arduino core: its integer types and a simulated
+// clock. millis() only moves when a test, or the fake HeatPump library
+// blocking on the link, advances it, so hours of operation run in
+// milliseconds and every run is repeatable.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <cstdint>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+inline uint32_t simulated_millis = 0;
+
+inline uint32_t millis() { return simulated_millis; }
+inline void delay(uint32_t ms) { simulated_millis += ms; }
+
+// Nothing is sent on the host, the fake HeatPump library talks to its
+// emulated unit directly.
+class HardwareSerial {};
+
+#endif
@@ -0,0 +1,406 @@
+// Host stand-in for the SwiCago HeatPump library, see HeatPump.h.
+
+#include "HeatPump.h"
+
+#include <cmath>
+#include <cstdlib>
+
+static const byte POWER[2] = {0x00, 0x01};
+static const char* POWER_MAP[2] = {"OFF", "ON"};
+static const byte MODE[5] = {0x01, 0x02, 0x03, 0x07, 0x08};
+static const char* MODE_MAP[5] = {"HEAT", "DRY", "COOL", "FAN", "AUTO"};
+static const byte FAN[6] = {0x00, 0x01, 0x02, 0x03, 0x05, 0x06};
+static const char* FAN_MAP[6] = {"AUTO", "QUIET", "1", "2", "3", "4"};
+static const byte VANE[7] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x07};
+static const char* VANE_MAP[7] = {"AUTO", "1", "2", "3", "4", "5", "SWING"};
+static const byte WIDEVANE[7] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x08, 0x0c};
+static const char* WIDEVANE_MAP[7] = {"<<", "<", "|", ">", ">>", "<>", "SWING"};
+
+// Info packets requested in turn by sync(): settings, room temperature, an
+// unknown one, timers, status and standby.
+static const byte INFOMODE[6] = {0x02, 0x03, 0x04, 0x05, 0x06, 0x09};
+
+static const byte PACKET_SET = 0x41;
+static const byte PACKET_INFO = 0x42;
+static const byte PACKET_CONNECT = 0x5a;
+static const byte PACKET_SET_ACK = 0x61;
+static const byte PACKET_INFO_RESPONSE = 0x62;
+static const byte PACKET_CONNECT_ACK = 0x7a;
+
+static const uint8_t HEADER_LENGTH = 5;
+static const uint8_t DATA_LENGTH = 16;
+
+// Pointer into map for value, which may be any string with the same text,
+// or nullptr if it isn't a known setting.
+template<size_t N>
+static const char* lookup(const char* (&map)[N], const char* value) {
+    for (size_t i = 0; value != nullptr && i < N; i++) {
+        if (strcmp(map[i], value) == 0) {
+            return map[i];
+        }
+    }
+    return nullptr;
+}
+
+template<size_t N>
+static byte encode(const byte (&bytes)[N], const char* (&map)[N], const char* value) {
+    for (size_t i = 0; value != nullptr && i < N; i++) {
+        if (strcmp(map[i], value) == 0) {
+            return bytes[i];
+        }
+    }
+    return bytes[0];
+}
+
+template<size_t N>
+static const char* decode(const byte (&bytes)[N], const char* (&map)[N], byte value) {
+    for (size_t i = 0; i < N; i++) {
+        if (bytes[i] == value) {
+            return map[i];
+        }
+    }
+    return map[0];
+}
+
+static byte encodeTemperature(float temperature) {
+    return 0x80 + static_cast<byte>(lroundf(temperature * 2));
+}
+
+static float decodeTemperature(byte value) {
+    return (value - 0x80) / 2.0f;
+}
+
+static byte checksum(const byte* bytes, uint8_t length) {
+    byte sum = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+    return 0xfc - sum;
+}
+
+// Frames data as a CN105 packet of the given type, returns its length.
+static uint8_t frame(byte* packet, byte type, const byte* data, uint8_t length) {
+    packet[0] = 0xfc;
+    packet[1] = type;
+    packet[2] = 0x01;
+    packet[3] = 0x30;
+    packet[4] = length;
+    if (length > 0) {
+        memcpy(packet + HEADER_LENGTH, data, length);
+    }
+    packet[HEADER_LENGTH + length] = checksum(packet, HEADER_LENGTH + length);
+    return HEADER_LENGTH + length + 1;
+}
+
+bool operator==(const heatpumpSettings& lhs, const heatpumpSettings& rhs) {
+    return lhs.power == rhs.power &&
+        lhs.mode == rhs.mode &&
+        lhs.temperature == rhs.temperature &&
+        lhs.fan == rhs.fan &&
+        lhs.vane == rhs.vane &&
+        lhs.wideVane == rhs.wideVane &&
+        lhs.iSee == rhs.iSee;
+}
+
+bool operator!=(const heatpumpSettings& lhs, const heatpumpSettings& rhs) {
+    return !(lhs == rhs);
+}
+
+uint8_t EmulatedUnit::receive(const byte* packet, uint8_t length, byte* response) {
+    if (length < HEADER_LENGTH + 1 || packet[0] != 0xfc ||
+        HEADER_LENGTH + packet[4] + 1 != length ||
+        checksum(packet, length - 1) != packet[length - 1]) {
+        return 0;
+    }
+
+    const byte* data = packet + HEADER_LENGTH;
+    byte out[DATA_LENGTH] = {};
+    switch (packet[1]) {
+        case PACKET_CONNECT:
+            return frame(response, PACKET_CONNECT_ACK, nullptr, 0);
+
+        case PACKET_SET:
+            sets_received_++;
+            if (rand() % 100 < drop_percent) {
+                sets_dropped_++;
+                return 0;
+            }
+            if (data[0] == 0x01) {
+                applySet(data);
+            } else if (data[0] == 0x07) {
+                remote_temperature_set_ = data[1] & 0x01;
+                remote_temperature_ = decodeTemperature(data[3]);
+            }
+            return frame(response, PACKET_SET_ACK, out, DATA_LENGTH);
+
+        case PACKET_INFO:
+            info_requests_++;
+            out[0] = data[0];
+            if (data[0] == 0x02) {
+                if (stale_left_ > 0) {
+                    stale_left_--;
+                } else {
+                    reported_ = current();
+                }
+                out[3] = encode(POWER, POWER_MAP, reported_.power);
+                out[4] = encode(MODE, MODE_MAP, reported_.mode);
+                out[6] = encode(FAN, FAN_MAP, reported_.fan);
+                out[7] = encode(VANE, VANE_MAP, reported_.vane);
+                out[10] = encode(WIDEVANE, WIDEVANE_MAP, reported_.wide_vane);
+                out[11] = encodeTemperature(reported_.temperature);
+            } else if (data[0] == 0x03) {
+                out[6] = encodeTemperature(
+                    remote_temperature_set_ ? remote_temperature_ : room_temperature);
+            } else if (data[0] == 0x06) {
+                out[3] = compressor_frequency;
+                out[4] = operating ? 0x01 : 0x00;
+            }
+            return frame(response, PACKET_INFO_RESPONSE, out, DATA_LENGTH);
+
+        default:
+            return 0;
+    }
+}
+
+EmulatedUnit::Settings EmulatedUnit::current() const {
+    return Settings{power, mode, temperature, fan, vane, wide_vane};
+}
+
+void EmulatedUnit::applySet(const byte* data) {
+    if (stale_left_ == 0) {
+        reported_ = current();
+    }
+    stale_left_ = stale_readbacks;
+
+    if (data[1] & 0x01) {
+        power = decode(POWER, POWER_MAP, data[3]);
+    }
+    if (data[1] & 0x02) {
+        mode = decode(MODE, MODE_MAP, data[4]);
+    }
+    if (data[1] & 0x04) {
+        temperature = decodeTemperature(data[14]);
+    }
+    if (data[1] & 0x08) {
+        fan = decode(FAN, FAN_MAP, data[6]);
+    }
+    if (data[1] & 0x10) {
+        vane = decode(VANE, VANE_MAP, data[7]);
+    }
+    if (data[2] & 0x01) {
+        wide_vane = decode(WIDEVANE, WIDEVANE_MAP, data[13]);
+    }
+}
+
+bool HeatPump::connect(HardwareSerial* /* serial */, int /* bitrate */, int /* rx */, int /* tx */) {
+    connected_ = false;
+    info_mode_ = 0;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        static const byte CONNECT[2] = {0xca, 0x01};
+        byte packet[PACKET_LEN];
+        writePacket(packet, frame(packet, PACKET_CONNECT, CONNECT, sizeof(CONNECT)));
+        delay(1100);
+        if (readPacket() == RCVD_PKT_CONNECT_SUCCESS) {
+            connected_ = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HeatPump::update() {
+    while (!canSend(false)) {
+        delay(10);
+    }
+
+    // Only fields that differ from the last readback are flagged.
+    byte data[DATA_LENGTH] = {0x01};
+    const heatpumpSettings& wanted = wanted_settings_;
+    if (wanted.power != current_settings_.power) {
+        data[1] |= 0x01;
+        data[3] = encode(POWER, POWER_MAP, wanted.power);
+    }
+    if (wanted.mode != current_settings_.mode) {
+        data[1] |= 0x02;
+        data[4] = encode(MODE, MODE_MAP, wanted.mode);
+    }
+    if (wanted.temperature != current_settings_.temperature) {
+        data[1] |= 0x04;
+        data[14] = encodeTemperature(wanted.temperature);
+    }
+    if (wanted.fan != current_settings_.fan) {
+        data[1] |= 0x08;
+        data[6] = encode(FAN, FAN_MAP, wanted.fan);
+    }
+    if (wanted.vane != current_settings_.vane) {
+        data[1] |= 0x10;
+        data[7] = encode(VANE, VANE_MAP, wanted.vane);
+    }
+    if (wanted.wideVane != current_settings_.wideVane) {
+        data[2] |= 0x01;
+        data[13] = encode(WIDEVANE, WIDEVANE_MAP, wanted.wideVane);
+    }
+
+    byte packet[PACKET_LEN];
+    writePacket(packet, frame(packet, PACKET_SET, data, DATA_LENGTH));
+    delay(PACKET_SENT_INTERVAL_MS);
+    while (!rx_.empty()) {
+        if (readPacket() == RCVD_PKT_UPDATE_SUCCESS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HeatPump::sync(byte packetType) {
+    if (!connected_ || millis() - last_recv_ > PACKET_SENT_INTERVAL_MS * 10) {
+        connect(nullptr);
+    } else if (canRead()) {
+        readPacket();
+    } else if (canSend(true)) {
+        byte data[DATA_LENGTH] = {};
+        if (packetType != PACKET_TYPE_DEFAULT) {
+            data[0] = INFOMODE[packetType];
+        } else {
+            data[0] = INFOMODE[info_mode_];
+            info_mode_ = (info_mode_ + 1) % sizeof(INFOMODE);
+        }
+        byte packet[PACKET_LEN];
+        writePacket(packet, frame(packet, PACKET_INFO, data, DATA_LENGTH));
+    }
+}
+
+void HeatPump::setPowerSetting(const char* setting) {
+    if (const char* value = lookup(POWER_MAP, setting)) {
+        wanted_settings_.power = value;
+    }
+}
+
+void HeatPump::setModeSetting(const char* setting) {
+    if (const char* value = lookup(MODE_MAP, setting)) {
+        wanted_settings_.mode = value;
+    }
+}
+
+void HeatPump::setTemperature(float setting) {
+    setting = roundf(setting * 2) / 2;
+    wanted_settings_.temperature = setting < 10 ? 10 : (setting > 31 ? 31 : setting);
+}
+
+void HeatPump::setFanSpeed(const char* setting) {
+    if (const char* value = lookup(FAN_MAP, setting)) {
+        wanted_settings_.fan = value;
+    }
+}
+
+void HeatPump::setVaneSetting(const char* setting) {
+    if (const char* value = lookup(VANE_MAP, setting)) {
+        wanted_settings_.vane = value;
+    }
+}
+
+void HeatPump::setWideVaneSetting(const char* setting) {
+    if (const char* value = lookup(WIDEVANE_MAP, setting)) {
+        wanted_settings_.wideVane = value;
+    }
+}
+
+void HeatPump::setRemoteTemperature(float setting) {
+    byte data[DATA_LENGTH] = {0x07};
+    if (setting > 0) {
+        data[1] = 0x01;
+        data[3] = encodeTemperature(setting);
+    } else {
+        data[3] = 0x80;
+    }
+    while (!canSend(false)) {
+        delay(10);
+    }
+    byte packet[PACKET_LEN];
+    writePacket(packet, frame(packet, PACKET_SET, data, DATA_LENGTH));
+}
+
+bool HeatPump::canSend(bool isInfo) {
+    return millis() - last_send_ > static_cast<uint32_t>(isInfo ? PACKET_INFO_INTERVAL_MS : PACKET_SENT_INTERVAL_MS);
+}
+
+bool HeatPump::canRead() {
+    return wait_for_read_ && millis() - last_send_ > static_cast<uint32_t>(PACKET_SENT_INTERVAL_MS);
+}
+
+void HeatPump::writePacket(byte* packet, uint8_t length) {
+    if (packet_callback_) {
+        packet_callback_(packet, length, const_cast<char*>("packetSent"));
+    }
+    byte response[PACKET_LEN];
+    uint8_t response_length = unit_.receive(packet, length, response);
+    if (response_length > 0) {
+        rx_.emplace_back(response, response + response_length);
+    }
+    wait_for_read_ = true;
+    last_send_ = millis();
+}
+
+HeatPump::ReceivedPacket HeatPump::readPacket() {
+    if (rx_.empty()) {
+        return RCVD_PKT_FAIL;
+    }
+
+    std::vector<byte> packet = rx_.front();
+    rx_.pop_front();
+    if (packet_callback_) {
+        packet_callback_(packet.data(), packet.size(), const_cast<char*>("packetRecv"));
+    }
+    wait_for_read_ = false;
+    last_recv_ = millis();
+
+    const byte* data = packet.data() + HEADER_LENGTH;
+    if (packet[1] == PACKET_CONNECT_ACK) {
+        return RCVD_PKT_CONNECT_SUCCESS;
+    }
+    if (packet[1] == PACKET_SET_ACK) {
+        return RCVD_PKT_UPDATE_SUCCESS;
+    }
+    if (packet[1] != PACKET_INFO_RESPONSE) {
+        return RCVD_PKT_OTHER;
+    }
+
+    if (data[0] == 0x02) {
+        heatpumpSettings received = {};
+        received.power = decode(POWER, POWER_MAP, data[3]);
+        received.mode = decode(MODE, MODE_MAP, data[4]);
+        received.temperature = decodeTemperature(data[11]);
+        received.fan = decode(FAN, FAN_MAP, data[6]);
+        received.vane = decode(VANE, VANE_MAP, data[7]);
+        received.wideVane = decode(WIDEVANE, WIDEVANE_MAP, data[10]);
+        received.connected = true;
+        bool changed = received != current_settings_;
+        current_settings_ = received;
+        if (first_run_) {
+            wanted_settings_ = current_settings_;
+            first_run_ = false;
+        }
+        if (changed && settings_changed_callback_) {
+            settings_changed_callback_();
+        }
+        return RCVD_PKT_SETTINGS;
+    }
+
+    heatpumpStatus received = current_status_;
+    if (data[0] == 0x03) {
+        received.roomTemperature = decodeTemperature(data[6]);
+    } else if (data[0] == 0x06) {
+        received.compressorFrequency = data[3];
+        received.operating = data[4] != 0;
+    } else {
+        return RCVD_PKT_OTHER;
+    }
+    bool changed = received.roomTemperature != current_status_.roomTemperature ||
+        received.operating != current_status_.operating ||
+        received.compressorFrequency != current_status_.compressorFrequency;
+    current_status_ = received;
+    if (changed && status_changed_callback_) {
+        status_changed_callback_(current_status_);
+    }
+    return data[0] == 0x03 ? RCVD_PKT_ROOM_TEMP : RCVD_PKT_STATUS;
+}
@@ -0,0 +1,173 @@
+// Host stand-in for the SwiCago HeatPump library, talking CN105 to an
+// emulated unit instead of a serial port.
+//
+// The interface and pacing follow the library: a request may only be sent a
+// packet interval after the previous one, info requests cycle through the
+// same packet types, the response to one is read by a later sync(), and
+// update() blocks until the unit has had time to acknowledge its SET, which
+// only carries the fields that differ from the last settings read back.
+// Time spent blocking advances the simulated clock in Arduino.h rather than
+// the wall clock. Responses are read in the order the unit sent them;
+// update() processes anything still unread ahead of its acknowledgement.
+
+#ifndef HOST_HEATPUMP_H
+#define HOST_HEATPUMP_H
+
+#include "Arduino.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// As in the library.
+#define PACKET_LEN 22
+#define PACKET_SENT_INTERVAL_MS 1000
+#define PACKET_INFO_INTERVAL_MS 2000
+#define PACKET_TYPE_DEFAULT 99
+#define RQST_PKT_SETTINGS 0
+#define RQST_PKT_ROOM_TEMP 1
+#define RQST_PKT_STATUS 4
+
+struct heatpumpSettings {
+    const char* power;
+    const char* mode;
+    float temperature;
+    const char* fan;
+    const char* vane;
+    const char* wideVane;
+    bool iSee;
+    bool connected;
+};
+
+bool operator==(const heatpumpSettings& lhs, const heatpumpSettings& rhs);
+bool operator!=(const heatpumpSettings& lhs, const heatpumpSettings& rhs);
+
+struct heatpumpStatus {
+    float roomTemperature;
+    bool operating;
+    int compressorFrequency;
+};
+
+// The heatpump at the other end of the CN105 link. Tests set its fields
+// directly, e.g. to move the room temperature or to make the link lossy.
+class EmulatedUnit {
+public:
+    // Current settings, as library strings.
+    const char* power = "ON";
+    const char* mode = "HEAT";
+    float temperature = 20;
+    const char* fan = "AUTO";
+    const char* vane = "AUTO";
+    const char* wide_vane = "|";
+
+    float room_temperature = 21;
+    bool operating = false;
+    int compressor_frequency = 0;
+
+    // Share of SET packets lost on the wire, in percent. A lost SET is
+    // neither applied nor acknowledged.
+    int drop_percent = 0;
+    // Number of settings responses that still show the previous settings
+    // after a SET was applied.
+    uint8_t stale_readbacks = 0;
+
+    // Answers a packet from the controller. Returns the length of the
+    // response written to response, or 0 if there is none.
+    uint8_t receive(const byte* packet, uint8_t length, byte* response);
+
+    uint32_t getSetsReceived() const { return sets_received_; }
+    uint32_t getSetsDropped() const { return sets_dropped_; }
+    uint32_t getInfoRequests() const { return info_requests_; }
+
+private:
+    struct Settings {
+        const char* power;
+        const char* mode;
+        float temperature;
+        const char* fan;
+        const char* vane;
+        const char* wide_vane;
+    };
+
+    Settings current() const;
+    void applySet(const byte* data);
+
+    Settings reported_ = {};
+    uint8_t stale_left_ = 0;
+    bool remote_temperature_set_ = false;
+    float remote_temperature_ = 0;
+
+    uint32_t sets_received_ = 0;
+    uint32_t sets_dropped_ = 0;
+    uint32_t info_requests_ = 0;
+};
+
+class HeatPump {
+public:
+    typedef std::function<void()> SETTINGS_CHANGED_CALLBACK_SIGNATURE;
+    typedef std::function<void(heatpumpStatus newStatus)> STATUS_CHANGED_CALLBACK_SIGNATURE;
+    typedef std::function<void(byte* packet, unsigned int length, char* packetDirection)> PACKET_CALLBACK_SIGNATURE;
+
+    bool connect(HardwareSerial* serial, int bitrate = 2400, int rx = -1, int tx = -1);
+    bool update();
+    void sync(byte packetType = PACKET_TYPE_DEFAULT);
+    void enableExternalUpdate() {}
+    bool isConnected() { return connected_; }
+
+    heatpumpSettings getSettings() { return current_settings_; }
+    void setPowerSetting(const char* setting);
+    void setModeSetting(const char* setting);
+    void setTemperature(float setting);
+    void setFanSpeed(const char* setting);
+    void setVaneSetting(const char* setting);
+    void setWideVaneSetting(const char* setting);
+    void setRemoteTemperature(float setting);
+
+    float getRoomTemperature() { return current_status_.roomTemperature; }
+    heatpumpStatus getStatus() { return current_status_; }
+
+    void setSettingsChangedCallback(SETTINGS_CHANGED_CALLBACK_SIGNATURE callback) { settings_changed_callback_ = callback; }
+    void setStatusChangedCallback(STATUS_CHANGED_CALLBACK_SIGNATURE callback) { status_changed_callback_ = callback; }
+    void setPacketCallback(PACKET_CALLBACK_SIGNATURE callback) { packet_callback_ = callback; }
+
+    // Host only.
+    EmulatedUnit& getUnit() { return unit_; }
+
+private:
+    enum ReceivedPacket {
+        RCVD_PKT_FAIL,
+        RCVD_PKT_CONNECT_SUCCESS,
+        RCVD_PKT_SETTINGS,
+        RCVD_PKT_ROOM_TEMP,
+        RCVD_PKT_UPDATE_SUCCESS,
+        RCVD_PKT_STATUS,
+        RCVD_PKT_OTHER
+    };
+
+    bool canSend(bool isInfo);
+    bool canRead();
+    void writePacket(byte* packet, uint8_t length);
+    ReceivedPacket readPacket();
+
+    EmulatedUnit unit_;
+    std::deque<std::vector<byte>> rx_;
+
+    heatpumpSettings current_settings_ = {};
+    heatpumpSettings wanted_settings_ = {};
+    heatpumpStatus current_status_ = {};
+    bool connected_ = false;
+    bool first_run_ = true;
+    bool wait_for_read_ = false;
+    uint32_t last_send_ = 0;
+    uint32_t last_recv_ = 0;
+    uint8_t info_mode_ = 0;
+
+    SETTINGS_CHANGED_CALLBACK_SIGNATURE settings_changed_callback_;
+    STATUS_CHANGED_CALLBACK_SIGNATURE status_changed_callback_;
+    PACKET_CALLBACK_SIGNATURE packet_callback_;
+};
+
+#endif
@@ -0,0 +1,21 @@
+// Host stand-in for esphome.h: logging compiles to nothing.
+
+#ifndef HOST_ESPHOME_H
+#define HOST_ESPHOME_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace esphome {
+inline void esp_log_printf_(int, const char*, int, const char*, ...) {}
+}
+
+#define ESP_LOGE(tag, ...) esphome::esp_log_printf_(1, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) esphome::esp_log_printf_(2, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) esphome::esp_log_printf_(3, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) esphome::esp_log_printf_(5, tag, __LINE__, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) esphome::esp_log_printf_(6, tag, __LINE__, __VA_ARGS__)
+
+#endif
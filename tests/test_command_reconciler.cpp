@@ -0,0 +1,314 @@
+// CommandReconciler over a lossy CN105 link.
+//
+// A simulated unit takes SET packets, some of which are dropped, and keeps
+// reporting its old settings for a few readbacks after applying one. The
+// reconciler must hold those stale readbacks back, write unconfirmed fields
+// again with a doubling timeout, and give up after MAX_RETRIES. LossyLink
+// writes whatever is pending; TwoPointHeatPump's own write path, which skips
+// and holds some requests, is covered by test_two_point_heatpump.
+
+#include "CommandReconciler.h"
+#include "check.h"
+
+#include <cstdlib>
+
+static const uint32_t SYNC_MS = 1000;
+
+class LossyLink {
+public:
+    LossyLink() {
+        unit_.power = HeatpumpPowerSetting::ON;
+        unit_.mode = HeatpumpModeSetting::HEAT;
+        unit_.temperature = 20;
+        unit_.fan = HeatpumpFanSetting::AUTO;
+        unit_.vane = HeatpumpVaneSetting::AUTO;
+        unit_.wideVane = HeatpumpWideVaneSetting::CENTER;
+        reported_ = unit_;
+    }
+
+    // Requests a temperature, as TwoPointHeatPump's setters do.
+    void setTemperature(float temperature) {
+        pending_.temperature = temperature;
+        pending_.markDirty(PendingWrite::TEMPERATURE, now_);
+    }
+
+    void setFan(HeatpumpFanSetting fan) {
+        pending_.fan = fan;
+        pending_.markDirty(PendingWrite::FAN, now_);
+    }
+
+    // One update cycle: send what's pending, then read the unit back.
+    // Returns what onReadback() returned.
+    bool sync() {
+        if (pending_.dirty != 0) {
+            sets_sent_++;
+            if (!shouldDrop()) {
+                deliver(pending_);
+            }
+            reconciler_.onWritten(pending_, now_);
+            pending_ = PendingWrite();
+        }
+
+        if (stale_readbacks_left_ > 0) {
+            stale_readbacks_left_--;
+        } else {
+            reported_ = unit_;
+        }
+
+        PendingWrite retry;
+        bool failed = reconciler_.onReadback(reported_, now_, &retry);
+        if (retry.dirty != 0) {
+            retry.queued_at = now_;
+            pending_ = retry;
+        }
+        now_ += SYNC_MS;
+        return failed;
+    }
+
+    // What would be published: the readback with in flight fields applied.
+    HeatpumpSettingsModel published() const {
+        HeatpumpSettingsModel settings = reported_;
+        reconciler_.apply(&settings);
+        return settings;
+    }
+
+    // Drop every SET, none, or each with the given probability in percent.
+    void setDropPercent(int percent) { drop_percent_ = percent; }
+    // Number of readbacks that still show the old settings after a SET.
+    void setStaleReadbacks(uint8_t count) { stale_readbacks_ = count; }
+    // Fields the unit silently ignores.
+    void setIgnoredFields(uint8_t fields) { ignored_fields_ = fields; }
+
+    const CommandReconciler& reconciler() const { return reconciler_; }
+    const HeatpumpSettingsModel& unit() const { return unit_; }
+    uint32_t setsSent() const { return sets_sent_; }
+    uint32_t now() const { return now_; }
+
+private:
+    bool shouldDrop() const { return rand() % 100 < drop_percent_; }
+
+    void deliver(const PendingWrite& write) {
+        uint8_t applied = write.dirty & ~ignored_fields_;
+        if (applied & PendingWrite::TEMPERATURE) {
+            unit_.temperature = write.temperature;
+        }
+        if (applied & PendingWrite::FAN) {
+            unit_.fan = write.fan;
+        }
+        stale_readbacks_left_ = stale_readbacks_;
+    }
+
+    CommandReconciler reconciler_;
+    HeatpumpSettingsModel unit_;
+    HeatpumpSettingsModel reported_;
+    PendingWrite pending_;
+    uint32_t now_ = 0;
+    uint32_t sets_sent_ = 0;
+    int drop_percent_ = 0;
+    uint8_t stale_readbacks_ = 0;
+    uint8_t stale_readbacks_left_ = 0;
+    uint8_t ignored_fields_ = 0;
+};
+
+static void checkStaleReadbacksHeldBack() {
+    LossyLink link;
+    link.setStaleReadbacks(2);
+    link.setTemperature(23);
+
+    // The unit still reports 20 for two readbacks.
+    CHECK(!link.sync());
+    CHECK_EQ(link.published().temperature, 23);
+    CHECK(!link.sync());
+    CHECK_EQ(link.published().temperature, 23);
+    CHECK(!link.sync());
+    CHECK_EQ(link.published().temperature, 23);
+
+    const CommandReconciler& reconciler = link.reconciler();
+    CHECK_EQ(reconciler.getConfirmed(), 1u);
+    CHECK_EQ(reconciler.getSuppressed(), 2u);
+    CHECK_EQ(reconciler.getRetries(), 0u);
+    CHECK_EQ(reconciler.getFailures(), 0u);
+    CHECK_EQ(link.setsSent(), 1u);
+    CHECK(!reconciler.hasInFlight());
+}
+
+static void checkDroppedSetRetried() {
+    LossyLink link;
+    link.setDropPercent(100);
+    link.setTemperature(23);
+    link.sync();
+
+    // Nothing is retried until the confirm timeout has passed.
+    while (link.reconciler().getRetries() == 0) {
+        CHECK(!link.sync());
+        CHECK_EQ(link.published().temperature, 23);
+    }
+    uint32_t retried_at = link.now() - SYNC_MS;
+    CHECK(retried_at >= CommandReconciler::CONFIRM_TIMEOUT);
+    CHECK(retried_at < CommandReconciler::CONFIRM_TIMEOUT + SYNC_MS);
+    CHECK_EQ(link.setsSent(), 1u);
+
+    // The retry gets through.
+    link.setDropPercent(0);
+    for (int i = 0; i < 3; i++) {
+        link.sync();
+    }
+    const CommandReconciler& reconciler = link.reconciler();
+    CHECK_EQ(link.unit().temperature, 23);
+    CHECK_EQ(reconciler.getRetries(), 1u);
+    CHECK_EQ(reconciler.getConfirmed(), 1u);
+    CHECK_EQ(reconciler.getFailures(), 0u);
+    CHECK_EQ(reconciler.getConfirmLatency().count, 1u);
+}
+
+static void checkGiveUpWithDoublingTimeout() {
+    LossyLink link;
+    link.setDropPercent(100);
+    link.setTemperature(23);
+
+    uint32_t sent_at[CommandReconciler::MAX_RETRIES + 1];
+    uint8_t sent = 0;
+    uint32_t failed_at = 0;
+    for (int i = 0; i < 120 && failed_at == 0; i++) {
+        uint32_t before = link.setsSent();
+        uint32_t now = link.now();
+        if (link.sync()) {
+            failed_at = now;
+        }
+        if (link.setsSent() != before) {
+            sent_at[sent++] = now;
+        }
+    }
+
+    const CommandReconciler& reconciler = link.reconciler();
+    CHECK_EQ(sent, CommandReconciler::MAX_RETRIES + 1);
+    CHECK_EQ(reconciler.getRetries(), static_cast<uint32_t>(CommandReconciler::MAX_RETRIES));
+    CHECK_EQ(reconciler.getFailures(), 1u);
+    CHECK_EQ(reconciler.getConfirmed(), 0u);
+    CHECK(failed_at != 0);
+    CHECK(!reconciler.hasInFlight());
+
+    // Each retry waits twice as long as the one before.
+    for (uint8_t i = 1; i < sent; i++) {
+        uint32_t timeout = CommandReconciler::CONFIRM_TIMEOUT << (i - 1);
+        uint32_t gap = sent_at[i] - sent_at[i - 1];
+        CHECK(gap >= timeout);
+        CHECK(gap <= timeout + 2 * SYNC_MS);
+    }
+
+    // Once given up on, the unit's own value is published again.
+    CHECK_EQ(link.published().temperature, 20);
+}
+
+static void checkIgnoredFieldFailsAlone() {
+    LossyLink link;
+    link.setIgnoredFields(PendingWrite::FAN);
+    link.setTemperature(22);
+    link.setFan(HeatpumpFanSetting::SPEED_2);
+    for (int i = 0; i < 120; i++) {
+        link.sync();
+    }
+
+    const CommandReconciler& reconciler = link.reconciler();
+    CHECK_EQ(link.unit().temperature, 22);
+    CHECK_EQ(reconciler.getConfirmed(), 1u);
+    CHECK_EQ(reconciler.getRetries(), static_cast<uint32_t>(CommandReconciler::MAX_RETRIES));
+    CHECK_EQ(reconciler.getFailures(), 1u);
+    CHECK(link.published().fan == HeatpumpFanSetting::AUTO);
+}
+
+static void checkNewValueReplacesRetry() {
+    LossyLink link;
+    link.setDropPercent(100);
+    link.setTemperature(23);
+    for (int i = 0; i < 8; i++) {
+        link.sync();
+    }
+    CHECK_EQ(link.reconciler().getRetries(), 1u);
+
+    // A different value is a new command, not another attempt.
+    link.setDropPercent(0);
+    link.setTemperature(24);
+    for (int i = 0; i < 3; i++) {
+        link.sync();
+    }
+    CHECK_EQ(link.unit().temperature, 24);
+    CHECK_EQ(link.published().temperature, 24);
+    CHECK_EQ(link.reconciler().getConfirmed(), 1u);
+    CHECK_EQ(link.reconciler().getFailures(), 0u);
+}
+
+// A write that's skipped because the unit already reports it ends whatever
+// was in flight for its fields. Otherwise the earlier value would be retried
+// over the request.
+static void checkSkippedWriteEndsInFlight() {
+    CommandReconciler reconciler;
+    HeatpumpSettingsModel unit;
+    unit.power = HeatpumpPowerSetting::ON;
+    unit.temperature = 20;
+
+    PendingWrite lost;
+    lost.temperature = 23;
+    lost.markDirty(PendingWrite::TEMPERATURE, 0);
+    reconciler.onWritten(lost, 0);
+    CHECK(reconciler.hasInFlight());
+
+    PendingWrite skipped;
+    skipped.temperature = 20;
+    skipped.markDirty(PendingWrite::TEMPERATURE, SYNC_MS);
+    reconciler.onSkipped(skipped);
+    CHECK(!reconciler.hasInFlight());
+
+    PendingWrite retry;
+    CHECK(!reconciler.onReadback(unit, 4 * CommandReconciler::CONFIRM_TIMEOUT, &retry));
+    CHECK_EQ(retry.dirty, 0);
+    HeatpumpSettingsModel published = unit;
+    reconciler.apply(&published);
+    CHECK_EQ(published.temperature, 20);
+    CHECK_EQ(reconciler.getRetries(), 0u);
+}
+
+// Many commands over a link that drops a share of SETs: every command is
+// eventually either confirmed or given up on, and what's published settles
+// on what the unit reports.
+static void checkLossyLink(int drop_percent) {
+    srand(drop_percent);
+    LossyLink link;
+    link.setDropPercent(drop_percent);
+    link.setStaleReadbacks(2);
+
+    const uint32_t COMMANDS = 500;
+    for (uint32_t i = 0; i < COMMANDS; i++) {
+        link.setTemperature(i % 2 ? 21 : 22.5);
+        // Long enough for every retry to run out.
+        for (int j = 0; j < 90; j++) {
+            link.sync();
+        }
+        CHECK(!link.reconciler().hasInFlight());
+        CHECK_EQ(link.published().temperature, link.unit().temperature);
+    }
+
+    const CommandReconciler& reconciler = link.reconciler();
+    printf("%d%% of SETs dropped: %u confirmed, %u retries, %u failed, p50/p99 %u/%u ms\n",
+        drop_percent, reconciler.getConfirmed(), reconciler.getRetries(), reconciler.getFailures(),
+        reconciler.getRecentConfirmLatency().percentile(50),
+        reconciler.getRecentConfirmLatency().percentile(99));
+    CHECK_EQ(reconciler.getConfirmed() + reconciler.getFailures(), COMMANDS);
+    CHECK_EQ(link.setsSent(), COMMANDS + reconciler.getRetries());
+    if (drop_percent == 0) {
+        CHECK_EQ(reconciler.getRetries(), 0u);
+    }
+}
+
+int main() {
+    checkStaleReadbacksHeldBack();
+    checkDroppedSetRetried();
+    checkGiveUpWithDoublingTimeout();
+    checkIgnoredFieldFailsAlone();
+    checkNewValueReplacesRetry();
+    checkSkippedWriteEndsInFlight();
+    checkLossyLink(0);
+    checkLossyLink(30);
+    checkLossyLink(70);
+    return checkResult();
+}
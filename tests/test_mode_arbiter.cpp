@@ -0,0 +1,136 @@
+// ModeArbiter's HEAT/COOL decisions in managed dual point mode.
+//
+// Setpoints are 20 and 24 with the default config: a 0.5 degree deadband,
+// 5 minutes minimum run time, 3 minutes minimum off time and 10 minutes
+// between switches.
+
+#include "ModeArbiter.h"
+#include "check.h"
+
+#include <cmath>
+
+static const float LOW = 20;
+static const float HIGH = 24;
+static const uint32_t MINUTE_MS = 60 * 1000;
+
+static void checkInitialModeClosestSetpoint() {
+    ModeArbiter below;
+    CHECK(below.decide(19, LOW, HIGH, 0) == HeatpumpMode::HEAT);
+    ModeArbiter above;
+    CHECK(above.decide(25, LOW, HIGH, 0) == HeatpumpMode::COOL);
+    ModeArbiter nearer_low;
+    CHECK(nearer_low.decide(21, LOW, HIGH, 0) == HeatpumpMode::HEAT);
+    ModeArbiter nearer_high;
+    CHECK(nearer_high.decide(23, LOW, HIGH, 0) == HeatpumpMode::COOL);
+
+    // Picking the first mode isn't a switch.
+    CHECK_EQ(below.getModeSwitches(), 0u);
+}
+
+static void checkDeadband() {
+    ModeArbiter heating;
+    heating.seed(HeatpumpMode::HEAT);
+    CHECK(heating.decide(HIGH, LOW, HIGH, 0) == HeatpumpMode::HEAT);
+    CHECK(heating.decide(HIGH + 0.4f, LOW, HIGH, 0) == HeatpumpMode::HEAT);
+    CHECK_EQ(heating.getModeSwitches(), 0u);
+    CHECK(heating.decide(HIGH + 0.5f, LOW, HIGH, 0) == HeatpumpMode::COOL);
+    CHECK_EQ(heating.getModeSwitches(), 1u);
+
+    ModeArbiter cooling;
+    cooling.seed(HeatpumpMode::COOL);
+    CHECK(cooling.decide(LOW - 0.4f, LOW, HIGH, 0) == HeatpumpMode::COOL);
+    CHECK(cooling.decide(LOW - 0.5f, LOW, HIGH, 0) == HeatpumpMode::HEAT);
+    CHECK_EQ(cooling.getModeSwitches(), 1u);
+
+    // A missing room temperature keeps the current mode.
+    CHECK(cooling.decide(NAN, LOW, HIGH, 0) == HeatpumpMode::HEAT);
+}
+
+static void checkMinRunTime() {
+    ModeArbiter arbiter;
+    arbiter.seed(HeatpumpMode::HEAT);
+    arbiter.onCompressorState(true, 0);
+
+    uint32_t run_time = arbiter.getConfig().min_run_time_ms;
+    CHECK(arbiter.decide(25, LOW, HIGH, run_time - 1) == HeatpumpMode::HEAT);
+    CHECK(arbiter.decide(25, LOW, HIGH, run_time) == HeatpumpMode::COOL);
+    CHECK_EQ(arbiter.getModeSwitches(), 1u);
+}
+
+static void checkMinOffTime() {
+    ModeArbiter arbiter;
+    arbiter.seed(HeatpumpMode::HEAT);
+    arbiter.onCompressorState(true, 0);
+    arbiter.onCompressorState(false, MINUTE_MS);
+
+    // Once stopped, the off time applies rather than the run time.
+    uint32_t off_time = arbiter.getConfig().min_off_time_ms;
+    CHECK(arbiter.decide(25, LOW, HIGH, MINUTE_MS + off_time - 1) == HeatpumpMode::HEAT);
+    CHECK(arbiter.decide(25, LOW, HIGH, MINUTE_MS + off_time) == HeatpumpMode::COOL);
+    CHECK_EQ(arbiter.getModeSwitches(), 1u);
+}
+
+static void checkSwitchCooldown() {
+    ModeArbiter arbiter;
+    arbiter.seed(HeatpumpMode::HEAT);
+    CHECK(arbiter.decide(25, LOW, HIGH, MINUTE_MS) == HeatpumpMode::COOL);
+
+    // The compressor has long been off, only the cooldown holds it.
+    arbiter.onCompressorState(false, 0);
+    uint32_t cooldown = arbiter.getConfig().switch_cooldown_ms;
+    CHECK(arbiter.decide(19, LOW, HIGH, MINUTE_MS + cooldown - 1) == HeatpumpMode::COOL);
+    CHECK(arbiter.decide(19, LOW, HIGH, MINUTE_MS + cooldown) == HeatpumpMode::HEAT);
+    CHECK_EQ(arbiter.getModeSwitches(), 2u);
+}
+
+static void checkHeldOffSwitchCountedOnce() {
+    ModeArbiter arbiter;
+    arbiter.seed(HeatpumpMode::HEAT);
+    arbiter.onCompressorState(true, 0);
+
+    for (uint32_t now = 0; now < 4 * MINUTE_MS; now += 1000) {
+        CHECK(arbiter.decide(25, LOW, HIGH, now) == HeatpumpMode::HEAT);
+    }
+    CHECK_EQ(arbiter.getSwitchesHeldOff(), 1u);
+
+    // Back inside the setpoints, then out again: a new held off switch.
+    CHECK(arbiter.decide(22, LOW, HIGH, 4 * MINUTE_MS) == HeatpumpMode::HEAT);
+    CHECK(arbiter.decide(25, LOW, HIGH, 4 * MINUTE_MS + 1000) == HeatpumpMode::HEAT);
+    CHECK(arbiter.decide(25, LOW, HIGH, 4 * MINUTE_MS + 2000) == HeatpumpMode::HEAT);
+    CHECK_EQ(arbiter.getSwitchesHeldOff(), 2u);
+
+    // Once allowed, the switch happens and nothing more is held off.
+    CHECK(arbiter.decide(25, LOW, HIGH, 5 * MINUTE_MS) == HeatpumpMode::COOL);
+    CHECK_EQ(arbiter.getSwitchesHeldOff(), 2u);
+    CHECK_EQ(arbiter.getModeSwitches(), 1u);
+}
+
+static void checkCompressorStartsCounted() {
+    ModeArbiter arbiter;
+    // The first report only tells the state, it's not a start.
+    arbiter.onCompressorState(true, 0);
+    CHECK_EQ(arbiter.getCompressorStarts(), 0u);
+
+    // Repeated reports of the same state aren't either.
+    arbiter.onCompressorState(true, 1000);
+    arbiter.onCompressorState(false, 2000);
+    arbiter.onCompressorState(false, 3000);
+    CHECK_EQ(arbiter.getCompressorStarts(), 0u);
+
+    arbiter.onCompressorState(true, 4000);
+    arbiter.onCompressorState(true, 5000);
+    arbiter.onCompressorState(false, 6000);
+    arbiter.onCompressorState(true, 7000);
+    CHECK_EQ(arbiter.getCompressorStarts(), 2u);
+}
+
+int main() {
+    checkInitialModeClosestSetpoint();
+    checkDeadband();
+    checkMinRunTime();
+    checkMinOffTime();
+    checkSwitchCooldown();
+    checkHeldOffSwitchCountedOnce();
+    checkCompressorStartsCounted();
+    return checkResult();
+}
@@ -0,0 +1,141 @@
+// Latency of SerialScheduler with one, two and three heatpumps on a node.
+//
+// Simulates the ESPHome main loop: each heatpump's loop() requests a turn
+// when it has serial work and, once granted, blocks for a synchronous sync
+// of SYNC_MS. Every unit must get an equal share of turns, and no unit may
+// wait longer than the other units' turns plus the gaps between them.
+
+#include "SerialScheduler.h"
+#include "check.h"
+
+static const uint32_t LOOP_MS = 1;
+static const uint32_t SYNC_MS = 40;
+static const uint32_t SIMULATED_MS = 10 * 60 * 1000;
+
+struct Result {
+    uint32_t turns[SerialScheduler::MAX_LINKS] = {};
+    uint32_t max_wait = 0;
+};
+
+// interval_ms is how long after its last turn a unit wants the next one, 0
+// keeps every unit permanently busy.
+static Result simulate(uint8_t units, uint32_t interval_ms) {
+    SerialScheduler scheduler;
+    uint8_t links[SerialScheduler::MAX_LINKS];
+    uint32_t next_request[SerialScheduler::MAX_LINKS] = {};
+    for (uint8_t i = 0; i < units; i++) {
+        links[i] = scheduler.registerLink();
+        CHECK_EQ(links[i], i);
+    }
+
+    Result result;
+    uint32_t now = 0;
+    while (now < SIMULATED_MS) {
+        for (uint8_t i = 0; i < units; i++) {
+            if (static_cast<int32_t>(now - next_request[i]) >= 0) {
+                scheduler.request(links[i], now);
+            }
+            if (scheduler.acquire(links[i], now)) {
+                now += SYNC_MS;
+                scheduler.release(now);
+                result.turns[i]++;
+                next_request[i] = now + interval_ms;
+            }
+        }
+        now += LOOP_MS;
+    }
+
+    for (uint8_t i = 0; i < units; i++) {
+        const RunningStats& wait = scheduler.getWaitTime(links[i]);
+        CHECK_EQ(wait.count, result.turns[i]);
+        if (wait.max > result.max_wait) {
+            result.max_wait = wait.max;
+        }
+    }
+    return result;
+}
+
+// Worst case wait with every other unit ahead in line: their turns, a gap
+// before each of them and one before this unit's own turn, and a loop
+// iteration of slack per turn.
+static uint32_t waitBound(uint8_t units) {
+    return (units - 1) * (SYNC_MS + LOOP_MS) + units * SerialScheduler::MIN_GAP_MS + LOOP_MS;
+}
+
+static void checkBusy(uint8_t units) {
+    Result result = simulate(units, 0);
+    uint32_t fewest = result.turns[0];
+    uint32_t most = result.turns[0];
+    for (uint8_t i = 1; i < units; i++) {
+        fewest = result.turns[i] < fewest ? result.turns[i] : fewest;
+        most = result.turns[i] > most ? result.turns[i] : most;
+    }
+    printf("%u unit(s), busy: %u..%u turns each, max wait %u ms (bound %u ms)\n",
+        units, fewest, most, result.max_wait, waitBound(units));
+    CHECK(fewest > 0);
+    CHECK(most - fewest <= 1);
+    CHECK(result.max_wait <= waitBound(units));
+}
+
+static void checkPolling(uint8_t units) {
+    // A typical 500 ms update_interval.
+    Result result = simulate(units, 500);
+    printf("%u unit(s), polling: max wait %u ms (bound %u ms)\n",
+        units, result.max_wait, waitBound(units));
+    CHECK(result.max_wait <= waitBound(units));
+}
+
+static void checkSingleUnitNeverWaits() {
+    Result result = simulate(1, 0);
+    CHECK_EQ(result.max_wait, 0u);
+}
+
+static void checkUnregisteredLinkNeverHeldBack() {
+    SerialScheduler scheduler;
+    for (uint8_t i = 0; i < SerialScheduler::MAX_LINKS; i++) {
+        scheduler.registerLink();
+    }
+    CHECK_EQ(scheduler.registerLink(), SerialScheduler::NO_LINK);
+    scheduler.request(0, 0);
+    CHECK(scheduler.acquire(0, 0));
+    CHECK(scheduler.acquire(SerialScheduler::NO_LINK, 1));
+}
+
+static void checkTiesGoRoundRobin() {
+    SerialScheduler scheduler;
+    for (uint8_t i = 0; i < 3; i++) {
+        scheduler.registerLink();
+    }
+    uint32_t now = 0;
+    uint8_t expected = 0;
+    uint32_t grants = 0;
+    for (uint8_t round = 0; round < 6; round++) {
+        for (uint8_t i = 0; i < 3; i++) {
+            scheduler.request(i, now);
+        }
+        // Requests made at the same time are granted in turn.
+        for (uint8_t granted = 0; granted < 3; granted++) {
+            now += SerialScheduler::MIN_GAP_MS;
+            for (uint8_t i = 0; i < 3; i++) {
+                if (scheduler.acquire(i, now)) {
+                    CHECK_EQ(i, expected);
+                    expected = (expected + 1) % 3;
+                    grants++;
+                    scheduler.release(now);
+                }
+            }
+        }
+    }
+    CHECK_EQ(grants, 18u);
+}
+
+int main() {
+    checkSingleUnitNeverWaits();
+    checkUnregisteredLinkNeverHeldBack();
+    checkTiesGoRoundRobin();
+    for (uint8_t units = 1; units <= SerialScheduler::MAX_LINKS; units++) {
+        checkBusy(units);
+        checkPolling(units);
+    }
+    return checkResult();
+}
@@ -0,0 +1,105 @@
+// TemperatureFusion: weighting, outlier exclusion and per sensor expiry.
+
+#include "TemperatureFusion.h"
+#include "check.h"
+
+#include <cmath>
+
+static bool near(float a, float b) {
+    return fabsf(a - b) < 0.001f;
+}
+
+static void checkWeightedMean() {
+    TemperatureFusion fusion;
+    float value = 0;
+    CHECK(!fusion.fuse(&value));
+
+    fusion.configure(1, 1, 0);
+    fusion.configure(2, 3, 0);
+    fusion.report(1, 20, 0);
+    fusion.report(2, 22, 0);
+    CHECK(fusion.fuse(&value));
+    CHECK(near(value, 21.5f));
+
+    // With two sensors neither is treated as an outlier.
+    fusion.report(2, 30, 1);
+    CHECK(fusion.fuse(&value));
+    CHECK(near(value, 27.5f));
+    CHECK_EQ(fusion.getOutliersExcluded(), 0u);
+}
+
+static void checkOutlierCountedOnce() {
+    TemperatureFusion fusion;
+    fusion.report(1, 21, 0);
+    fusion.report(2, 21.4f, 0);
+    fusion.report(3, 35, 0);
+
+    // A sensor that stays faulty is left out of every fuse, but counted
+    // once.
+    float value = 0;
+    for (uint32_t now = 0; now < 10; now++) {
+        fusion.report(3, 35 + now * 0.1f, now);
+        CHECK(fusion.fuse(&value));
+        CHECK(near(value, 21.2f));
+    }
+    CHECK_EQ(fusion.getOutliersExcluded(), 1u);
+
+    // Once it recovers and fails again, that's a second outlier.
+    fusion.report(3, 21.2f, 10);
+    CHECK(fusion.fuse(&value));
+    CHECK(near(value, 21.2f));
+    fusion.report(3, 10, 11);
+    CHECK(fusion.fuse(&value));
+    CHECK_EQ(fusion.getOutliersExcluded(), 2u);
+}
+
+static void checkExpiry() {
+    TemperatureFusion fusion;
+    fusion.configure(1, 1, 1000);
+    fusion.configure(2, 1, 5000);
+    fusion.report(1, 20, 0);
+    fusion.report(2, 22, 0);
+
+    uint32_t due = 0;
+    CHECK(fusion.nextExpiry(&due));
+    CHECK_EQ(due, 1000u);
+    CHECK_EQ(fusion.expire(999), 0);
+    CHECK_EQ(fusion.expire(1000), 1);
+    CHECK_EQ(fusion.getActiveCount(), 1);
+
+    // The other sensor carries on alone.
+    float value = 0;
+    CHECK(fusion.fuse(&value));
+    CHECK(near(value, 22));
+    CHECK(fusion.nextExpiry(&due));
+    CHECK_EQ(due, 5000u);
+
+    CHECK_EQ(fusion.expire(5000), 1);
+    CHECK(!fusion.fuse(&value));
+    CHECK(!fusion.nextExpiry(&due));
+    CHECK_EQ(fusion.getSensorsExpired(), 2u);
+}
+
+static void checkCapacity() {
+    TemperatureFusion fusion;
+    for (uint32_t id = 0; id < TemperatureFusion::MAX_SENSORS; id++) {
+        CHECK(fusion.report(id, 20, 0));
+    }
+    CHECK(!fusion.report(TemperatureFusion::MAX_SENSORS, 20, 0));
+    CHECK(!fusion.configure(TemperatureFusion::MAX_SENSORS, 1, 0));
+
+    // Dropped sensors keep their slot and configuration.
+    fusion.drop(0);
+    CHECK_EQ(fusion.getActiveCount(), TemperatureFusion::MAX_SENSORS - 1);
+    fusion.reset();
+    CHECK_EQ(fusion.getActiveCount(), 0);
+    CHECK(fusion.report(0, 20, 0));
+}
+
+int main() {
+    checkWeightedMean();
+    checkOutlierCountedOnce();
+    checkExpiry();
+    checkCapacity();
+    return checkResult();
+}
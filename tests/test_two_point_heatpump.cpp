@@ -0,0 +1,200 @@
+// TwoPointHeatPump's writes against the emulated unit in stubs/HeatPump.h.
+//
+// Each poll is one update_interval of MitsubishiHeatPump: a sync, then any
+// pending write once the unit's settings are known.
+
+#include "TwoPointHeatPump.h"
+#include "check.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static const uint32_t UPDATE_INTERVAL_MS = 500;
+
+static WriteResult poll(TwoPointHeatPump& hp) {
+    hp.sync();
+    WriteResult result = WriteResult::WRITE_NONE;
+    if (hp.getSettings().isValid()) {
+        result = hp.updateIfChangesPending();
+    }
+    simulated_millis += UPDATE_INTERVAL_MS;
+    return result;
+}
+
+static void pollFor(TwoPointHeatPump& hp, uint32_t duration_ms) {
+    uint32_t until = millis() + duration_ms;
+    while (millis() < until) {
+        poll(hp);
+    }
+}
+
+// Connects and polls until the unit has reported its settings.
+static void connect(TwoPointHeatPump& hp) {
+    simulated_millis = 0;
+    CHECK(hp.connect(nullptr));
+    for (int i = 0; i < 20 && !hp.getSettings().isValid(); i++) {
+        poll(hp);
+    }
+    CHECK(hp.getSettings().isValid());
+}
+
+static void checkMatchingWriteSkipped() {
+    TwoPointHeatPump hp(20, 24, false);
+    EmulatedUnit& unit = hp.getUnit();
+    connect(hp);
+
+    hp.setTemperature(20);
+    hp.setFanSpeed(HeatpumpFanSetting::AUTO);
+    hp.update();
+    CHECK_EQ(poll(hp), WriteResult::WRITE_SKIPPED);
+    CHECK_EQ(unit.getSetsReceived(), 0u);
+
+    // Once the unit has confirmed a write, a request matching it is
+    // skipped again.
+    hp.setTemperature(22);
+    hp.update();
+    CHECK_EQ(poll(hp), WriteResult::WRITE_ACKNOWLEDGED);
+    pollFor(hp, 30000);
+    CHECK(!hp.getReconciler().hasInFlight());
+    hp.setTemperature(22);
+    hp.update();
+    CHECK_EQ(poll(hp), WriteResult::WRITE_SKIPPED);
+    CHECK_EQ(unit.getSetsReceived(), 1u);
+}
+
+// A write is acknowledged but the unit keeps reporting the old value for a
+// while. Asking for the old value again must not be skipped because it
+// matches the stale readback, which would leave the unit at the first value.
+// The library wouldn't flag it in a SET either, so it's held until the unit
+// reports the first write.
+static void checkRevertOfUnconfirmedWrite() {
+    TwoPointHeatPump hp(20, 24, false);
+    EmulatedUnit& unit = hp.getUnit();
+    unit.stale_readbacks = 3;
+    connect(hp);
+
+    hp.setTemperature(22);
+    hp.update();
+    CHECK_EQ(poll(hp), WriteResult::WRITE_ACKNOWLEDGED);
+    CHECK_EQ(unit.temperature, 22);
+    CHECK_EQ(hp.HeatPump::getSettings().temperature, 20);
+    CHECK_EQ(hp.getSettings().temperature, 22);
+
+    hp.setTemperature(20);
+    hp.update();
+    CHECK_EQ(poll(hp), WriteResult::WRITE_NONE);
+    CHECK_EQ(hp.getSettings().temperature, 20);
+
+    pollFor(hp, 2 * 60 * 1000);
+    CHECK_EQ(unit.temperature, 20);
+    CHECK_EQ(hp.getSettings().temperature, 20);
+    CHECK(!hp.getReconciler().hasInFlight());
+    CHECK_EQ(hp.getReconciler().getFailures(), 0u);
+}
+
+// As above, with the first write lost on the wire. The held request waits
+// out the retries of the lost write rather than letting them write it again,
+// and is dropped once the unit turns out to already have it.
+static void checkRevertOfLostWrite() {
+    TwoPointHeatPump hp(20, 24, false);
+    EmulatedUnit& unit = hp.getUnit();
+    connect(hp);
+
+    unit.drop_percent = 100;
+    hp.setTemperature(22);
+    hp.update();
+    CHECK_EQ(poll(hp), WriteResult::WRITE_FAILED);
+    CHECK_EQ(unit.temperature, 20);
+    CHECK_EQ(hp.getSettings().temperature, 22);
+
+    unit.drop_percent = 0;
+    hp.setTemperature(20);
+    hp.update();
+    CHECK_EQ(poll(hp), WriteResult::WRITE_NONE);
+    CHECK_EQ(hp.getSettings().temperature, 20);
+
+    pollFor(hp, 2 * 60 * 1000);
+    CHECK_EQ(unit.temperature, 20);
+    CHECK_EQ(unit.getSetsReceived(), 1u);
+    CHECK_EQ(hp.getSettings().temperature, 20);
+    CHECK(!hp.getReconciler().hasInFlight());
+}
+
+// Managed dual point mode from boot. The mode is configured once the unit's
+// settings have been read; a write queued before then would keep sync()
+// from ever reading them.
+static void checkManagedModeBoots() {
+    TwoPointHeatPump hp(20, 24, true);
+    EmulatedUnit& unit = hp.getUnit();
+    unit.mode = "COOL";
+    unit.room_temperature = 18;
+    connect(hp);
+    pollFor(hp, 30000);
+    CHECK_EQ(strcmp(unit.mode, "HEAT"), 0);
+    CHECK_EQ(unit.temperature, 20);
+    CHECK(hp.getSettings().mode == HeatpumpModeSetting::DUAL_POINT);
+    CHECK(!hp.hasChangesPending());
+
+    // The mode is chosen from the room temperature, not from the 0 the
+    // library reports until it has been read: a warm room is cooled without
+    // heating it first.
+    TwoPointHeatPump warm(20, 24, true);
+    warm.getUnit().power = "OFF";
+    warm.getUnit().room_temperature = 26;
+    connect(warm);
+    pollFor(warm, 30000);
+    CHECK_EQ(strcmp(warm.getUnit().power, "ON"), 0);
+    CHECK_EQ(strcmp(warm.getUnit().mode, "COOL"), 0);
+    CHECK_EQ(warm.getUnit().getSetsReceived(), 1u);
+
+    // Likewise for an override set before the unit has been read.
+    TwoPointHeatPump overridden(20, 24, true);
+    overridden.setDesiredModeOverride(HeatpumpMode::COOL);
+    connect(overridden);
+    pollFor(overridden, 30000);
+    CHECK_EQ(strcmp(overridden.getUnit().mode, "COOL"), 0);
+    CHECK_EQ(overridden.getUnit().temperature, 24);
+    CHECK(!overridden.hasChangesPending());
+}
+
+// Requests against a link that loses SETs and reports stale settings, many
+// of them repeating a value the unit already reports and so taking the skip
+// path. Once the link settles the unit has the last request, and nothing is
+// left in flight to be retried over it.
+static void checkLossyLinkConverges() {
+    srand(1);
+    TwoPointHeatPump hp(20, 24, false);
+    EmulatedUnit& unit = hp.getUnit();
+    unit.drop_percent = 30;
+    unit.stale_readbacks = 2;
+    connect(hp);
+
+    static const float TEMPERATURES[] = {20, 20, 21, 21, 22};
+    uint32_t skipped = 0;
+    float last_temperature = 0;
+    for (int i = 0; i < 200; i++) {
+        last_temperature = TEMPERATURES[rand() % 5];
+        hp.setTemperature(last_temperature);
+        hp.update();
+        if (poll(hp) == WriteResult::WRITE_SKIPPED) {
+            skipped++;
+        }
+        pollFor(hp, (rand() % 20) * 1000);
+    }
+    unit.drop_percent = 0;
+    pollFor(hp, 3 * 60 * 1000);
+
+    CHECK(skipped > 0);
+    CHECK_EQ(unit.temperature, last_temperature);
+    CHECK_EQ(hp.getSettings().temperature, last_temperature);
+    CHECK(!hp.getReconciler().hasInFlight());
+}
+
+int main() {
+    checkMatchingWriteSkipped();
+    checkRevertOfUnconfirmedWrite();
+    checkRevertOfLostWrite();
+    checkManagedModeBoots();
+    checkLossyLinkConverges();
+    return checkResult();
+}